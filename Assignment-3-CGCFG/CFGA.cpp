@@ -9,22 +9,39 @@ using namespace SVF;
 using namespace llvm;
 using namespace std;
 
+static const Option<u32_t> CallStringLimit("cs-k", "Maximum call-string length of DFS contexts (0: unbounded)", 0);
+static const Option<std::string> ReadSnapshot("read-snapshot",
+                                              "Read the ICFG from an SVFIR snapshot written by 'svfir' instead of bitcode", "");
+
 int main(int argc, char **argv)
 {
     auto moduleNameVec =
             OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
                                      "[options] <input-bitcode...>");
 
+    if (!ReadSnapshot().empty())
+    {
+        SVFIRSnapshot snapshot;
+        if (!snapshot.open(ReadSnapshot()))
+        {
+            std::cout << "error reading snapshot " + ReadSnapshot() + "!!\n";
+            return 1;
+        }
+        CFGAnalysis analyzer(snapshot, CallStringLimit());
+        analyzer.analyze();
+        analyzer.dumpPaths();
+        return 0;
+    }
+
     LLVMModuleSet::buildSVFModule(moduleNameVec);
 
     SVFIRBuilder builder;
     auto pag = builder.build();
     auto icfg = pag->getICFG();
 
-    CFGAnalysis analyzer = CFGAnalysis(icfg);
+    CFGAnalysis analyzer = CFGAnalysis(icfg, CallStringLimit());
 
-    // TODO: complete the following method: 'CFGAnalysis::analyze'
-    analyzer.analyze(icfg);
+    analyzer.analyze();
 
     analyzer.dumpPaths();
     LLVMModuleSet::releaseLLVMModuleSet();
@@ -32,16 +49,55 @@ int main(int argc, char **argv)
 }
 
 
-void CFGAnalysis::analyze(SVF::ICFG *icfg)
+void CFGAnalysis::analyze()
 {
     // Sources and sinks are specified when an analyzer is instantiated.
     for (auto src : sources)
         for (auto snk : sinks)
         {
-            // TODO: DFS the graph, starting from src and detecting the paths ending at snk.
-            // Use the class method 'recordPath' (already defined) to record the path you detected.
             //@{
-
+            curPath.clear();
+            visited.clear();
+            dfs(src, snk, CallStringTable::EmptyContext);
             //@}
         }
 }
+
+
+void CFGAnalysis::dfs(unsigned node, unsigned snk, ContextID ctx)
+{
+    auto nodeCtx = std::make_pair(node, ctx);
+    if (!visited.insert(nodeCtx).second)
+        return;
+    curPath.push_back(node);
+
+    if (node == snk)
+        recordPath(curPath);
+
+    auto edges = outEdges.find(node);
+    if (edges != outEdges.end())
+    {
+        for (auto &edge : edges->second)
+        {
+            if (edge.kind == ICFGEdgeRecord::Intra)
+                dfs(edge.dst, snk, ctx);
+            else if (edge.kind == ICFGEdgeRecord::Call)
+            {
+                // Re-entering a call site already on the call string would only unroll recursion
+                if (!contexts.contains(ctx, edge.callSite))
+                    dfs(edge.dst, snk, contexts.push(ctx, edge.callSite));
+            }
+            else if (edge.kind == ICFGEdgeRecord::Ret)
+            {
+                // An empty context is either an unbalanced return or a call string truncated by the k-limit
+                if (contexts.empty(ctx))
+                    dfs(edge.dst, snk, ctx);
+                else if (contexts.top(ctx) == edge.callSite)
+                    dfs(edge.dst, snk, contexts.pop(ctx));
+            }
+        }
+    }
+
+    curPath.pop_back();
+    visited.erase(nodeCtx);
+}
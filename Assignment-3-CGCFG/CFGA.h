@@ -8,18 +8,93 @@
 
 #include "Graphs/SVFG.h"
 #include "SVF-LLVM/SVFIRBuilder.h"
+#include "SVFIRSnapshot.h"
 
+/**
+ * Hash-consed call-string contexts.
+ * A context is an ID naming an immutable (call site, parent context) node, so contexts share their tails and
+ * compare, hash and copy as plain integers. With a non-zero k-limit only the k most recent call sites are kept.
+ */
+class CallStringTable
+{
+public:
+    using ContextID = unsigned;
+    static constexpr ContextID EmptyContext = 0;
+
+    /// k == 0 keeps unbounded call strings
+    explicit CallStringTable(unsigned k = 0);
+
+    /// The context obtained by entering the callee at callSite from ctx
+    ContextID push(ContextID ctx, unsigned callSite);
+
+    /// The context obtained by returning from the innermost call of ctx
+    inline ContextID pop(ContextID ctx) const
+    { return nodes[ctx].parent; }
+
+    /// The innermost call site of ctx
+    inline unsigned top(ContextID ctx) const
+    { return nodes[ctx].callSite; }
+
+    inline bool empty(ContextID ctx) const
+    { return ctx == EmptyContext; }
+
+    inline unsigned depth(ContextID ctx) const
+    { return nodes[ctx].depth; }
+
+    /// Whether callSite occurs anywhere in ctx
+    bool contains(ContextID ctx, unsigned callSite) const;
+
+    /// Number of distinct contexts created so far (including the empty one)
+    inline size_t size() const
+    { return nodes.size(); }
+
+protected:
+    struct Node
+    {
+        unsigned callSite;
+        ContextID parent;
+        unsigned depth;
+    };
+
+    /// Return the unique node for (callSite, parent), creating it on first use
+    ContextID intern(ContextID parent, unsigned callSite);
+
+    static inline uint64_t key(ContextID ctx, unsigned callSite)
+    { return ((uint64_t) ctx << 32) | (uint64_t) callSite; }
+
+    unsigned kLimit;
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, ContextID> index;          ///< (parent, call site) -> context
+    std::unordered_map<uint64_t, ContextID> truncatedPush;  ///< memoized pushes that hit the k-limit
+};
+
+
+/**
+ * Paths from the entry to the exit of main over the ICFG, with calls and returns matched by call strings.
+ * The analysis keeps its own copy of the ICFG edges, built from a live ICFG or read from an SVFIR snapshot.
+ */
 class CFGAnalysis
 {
 public:
-    explicit CFGAnalysis(SVF::ICFG *icfg);
-    void analyze(SVF::ICFG *icfg);
+    explicit CFGAnalysis(SVF::ICFG *icfg, unsigned callStringLimit = 0);
+    explicit CFGAnalysis(const SVFIRSnapshot &snapshot, unsigned callStringLimit = 0);
+    void analyze();
     void dumpPaths();
 
 protected:
+    using ContextID = CallStringTable::ContextID;
+
+    /// Take the ICFG edges in [begin, end) and main's entry and exit as the sources and sinks
+    void loadICFG(const ICFGEdgeRecord *begin, const ICFGEdgeRecord *end, uint32_t mainEntry, uint32_t mainExit);
     void recordPath(const std::vector<unsigned> &path);
+    /// Context-sensitive DFS from node towards snk
+    void dfs(unsigned node, unsigned snk, ContextID ctx);
 
-    std::stack<unsigned> callStack;
+    std::string moduleName;     ///< names the result file
+    std::unordered_map<unsigned, std::vector<ICFGEdgeRecord>> outEdges;    ///< ICFG node -> its out-edges
+    CallStringTable contexts;
+    std::vector<unsigned> curPath;
+    std::set<std::pair<unsigned, ContextID>> visited;   ///< (node, context) pairs on the current path
     std::set<unsigned> sources;
     std::set<unsigned> sinks;
     std::set<std::vector<unsigned>> reachablePaths;
@@ -11,22 +11,85 @@ using namespace llvm;
 using namespace std;
 
 
-CFGAnalysis::CFGAnalysis(SVF::ICFG *icfg)
+CallStringTable::CallStringTable(unsigned k) :
+        kLimit(k)
 {
-    for (auto &it : *icfg)
-    {
-        auto node = it.second;
-        if (auto fEntry = dyn_cast<FunEntryICFGNode>(node))
-        {
-            if (fEntry->getFun()->getName() == "main")
-                sources.insert(it.first);
-        }
-        if (auto fExit = dyn_cast<FunExitICFGNode>(node))
-        {
-            if (fExit->getFun()->getName() == "main")
-                sinks.insert(it.first);
-        }
-    }
+    nodes.push_back({0, EmptyContext, 0});
+}
+
+
+CallStringTable::ContextID CallStringTable::intern(ContextID parent, unsigned callSite)
+{
+    auto it = index.find(key(parent, callSite));
+    if (it != index.end())
+        return it->second;
+
+    ContextID id = nodes.size();
+    nodes.push_back({callSite, parent, nodes[parent].depth + 1});
+    index.emplace(key(parent, callSite), id);
+    return id;
+}
+
+
+CallStringTable::ContextID CallStringTable::push(ContextID ctx, unsigned callSite)
+{
+    if (kLimit == 0 || nodes[ctx].depth < kLimit)
+        return intern(ctx, callSite);
+
+    auto it = truncatedPush.find(key(ctx, callSite));
+    if (it != truncatedPush.end())
+        return it->second;
+
+    // Drop the oldest call site and rebuild the remaining k - 1 from the bottom
+    std::vector<unsigned> callSites;
+    for (ContextID c = ctx; c != EmptyContext; c = nodes[c].parent)
+        callSites.push_back(nodes[c].callSite);
+    callSites.pop_back();
+
+    ContextID res = EmptyContext;
+    for (auto it2 = callSites.rbegin(); it2 != callSites.rend(); ++it2)
+        res = intern(res, *it2);
+    res = intern(res, callSite);
+
+    truncatedPush.emplace(key(ctx, callSite), res);
+    return res;
+}
+
+
+bool CallStringTable::contains(ContextID ctx, unsigned callSite) const
+{
+    for (ContextID c = ctx; c != EmptyContext; c = nodes[c].parent)
+        if (nodes[c].callSite == callSite)
+            return true;
+    return false;
+}
+
+
+CFGAnalysis::CFGAnalysis(SVF::ICFG *icfg, unsigned callStringLimit) :
+        moduleName(PAG::getPAG()->getModuleIdentifier()), contexts(callStringLimit)
+{
+    auto records = SVFIRSnapshot::collectICFG(icfg);
+    loadICFG(records.edges.data(), records.edges.data() + records.edges.size(), records.mainEntry,
+             records.mainExit);
+}
+
+
+CFGAnalysis::CFGAnalysis(const SVFIRSnapshot &snapshot, unsigned callStringLimit) :
+        moduleName(snapshot.getModuleIdentifier()), contexts(callStringLimit)
+{
+    loadICFG(snapshot.icfgEdgeBegin(), snapshot.icfgEdgeEnd(), snapshot.getMainEntry(), snapshot.getMainExit());
+}
+
+
+void CFGAnalysis::loadICFG(const ICFGEdgeRecord *begin, const ICFGEdgeRecord *end, uint32_t mainEntry,
+                           uint32_t mainExit)
+{
+    for (auto edge = begin; edge != end; ++edge)
+        outEdges[edge->src].push_back(*edge);
+    if (mainEntry != ICFGRecords::NoNode)
+        sources.insert(mainEntry);
+    if (mainExit != ICFGRecords::NoNode)
+        sinks.insert(mainExit);
 }
 
 
@@ -40,7 +103,7 @@ void CFGAnalysis::recordPath(const std::vector<unsigned int>& path)
 
 void CFGAnalysis::dumpPaths()
 {
-    std::string fname = PAG::getPAG()->getModuleIdentifier() + ".res.txt";
+    std::string fname = moduleName + ".res.txt";
     std::ofstream outFile(fname, std::ios::out);
     if (!outFile)
     {
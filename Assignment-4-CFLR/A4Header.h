@@ -6,9 +6,15 @@
 #ifndef ANSWERS_A4HEADER_H
 #define ANSWERS_A4HEADER_H
 
+#include <climits>
+#include <map>
+#include <unordered_set>
 #include <utility>
 
 #include "SVF-LLVM/SVFIRBuilder.h"
+#include "AnalysisArena.h"
+#include "PointsToIndex.h"
+#include "SVFIRSnapshot.h"
 
 using EdgeLabel = unsigned;
 
@@ -63,17 +69,35 @@ struct std::hash<CFLREdge>
 };
 
 
+/// Every label X is followed by its reverse XBar
+inline bool isBar(EdgeLabel label)
+{ return label & 1; }
+
+/// X for both X and XBar
+inline EdgeLabel baseLabel(EdgeLabel label)
+{ return label & ~1u; }
+
+
 /**
- * The graph for CFL-reachability-based pointer analysis
+ * The graph for CFL-reachability-based pointer analysis.
+ * Only labels X are stored; an XBar edge src -> dst is the X edge dst -> src read backwards, so every query on
+ * XBar is answered from the opposite-direction map.
+ * The PT successors of a node (its points-to set) are a WordSet over dense object indices instead of a hash set,
+ * so PT ::= VFBar PT propagates a whole set with the SetKernels.h kernels; read them with pointsTo, not successors.
  */
 class CFLRGraph
 {
 public:
     /// We use a source -> label -> target map to represent the adjacency list of the predecessors/successors of nodes.
-    using DataMap = std::unordered_map<unsigned, std::unordered_map<EdgeLabel, std::unordered_set<unsigned>>>;
+    using DataMap = std::pmr::unordered_map<unsigned, std::pmr::unordered_map<EdgeLabel, std::pmr::unordered_set<unsigned>>>;
+    using NodeSet = std::pmr::unordered_set<unsigned>;
+
+    /// Construct a graph from a PAG, with the adjacency maps allocated from mem
+    explicit CFLRGraph(SVF::SVFIR *pag, std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
-    /// Construct a graph from a PAG
-    explicit CFLRGraph(SVF::SVFIR *pag);
+    /// Construct a graph from the statements of an SVFIR snapshot, with the adjacency maps allocated from mem
+    explicit CFLRGraph(const SVFIRSnapshot &snapshot,
+                       std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     /**
      * Check whether an edge is already in the graph
@@ -85,13 +109,54 @@ public:
     bool hasEdge(unsigned src, unsigned dst, EdgeLabel label);
 
     /**
-     * Add an edge to the graph
+     * Add an edge to the graph (an XBar edge is stored as the reversed X edge)
      * @param src the source node of the edge
      * @param dst the target node of the edge
      * @param label the label of the edge
      */
     void addEdge(unsigned src, unsigned dst, EdgeLabel label);
 
+    /// Targets of the edges labelled 'label' leaving node (not for PT: see pointsTo)
+    const NodeSet &successors(unsigned node, EdgeLabel label) const;
+
+    /// Sources of the edges labelled 'label' entering node (not for PTBar: see pointsTo)
+    const NodeSet &predecessors(unsigned node, EdgeLabel label) const;
+
+    /// Objects node has PT edges to, as indices (see toObj)
+    const WordSet &pointsTo(unsigned node) const;
+
+    /// Object ID of an index in a pointsTo set
+    inline unsigned toObj(unsigned index) const
+    { return objOfIndex[index]; }
+
+    /**
+     * Give dst a PT edge to every object src has one to, with one word-parallel union
+     * @return the indices of the objects dst gained
+     */
+    WordSet unionPointsTo(unsigned dst, unsigned src);
+
+    /// Nodes with PT edges and their pointsTo sets
+    const std::pmr::unordered_map<unsigned, WordSet> &getPointsToMap() const
+    { return ptsMap; }
+
+    /**
+     * Merge every cycle of Copy edges into its smallest node: all nodes on such a cycle hold the same values, so
+     * they get the same points-to set. Cycles through an object (an Addr source) are left alone. Edges of merged
+     * nodes move to the representative, and Copy edges inside a cycle are dropped.
+     * @return the number of nodes merged into another
+     */
+    size_t collapseCopyCycles();
+
+    /// The node that stands for node after collapseCopyCycles
+    inline unsigned getRep(unsigned node) const
+    {
+        auto it = repOf.find(node);
+        return it == repOf.end() ? node : it->second;
+    }
+
+    /// Nodes merged into rep, rep included; empty if rep stands for itself only
+    const std::vector<unsigned> &getMembers(unsigned rep) const;
+
     DataMap &getSuccessorMap()
     { return succMap; }
 
@@ -99,8 +164,22 @@ public:
     { return predMap; }
 
 protected:
+    /// Add the edge of one statement (Gep and other statements the grammar has no label for are skipped)
+    void addStmt(const StmtRecord &stmt);
+    /// The set of label at node in map, or an empty set
+    static const NodeSet &lookup(const DataMap &map, unsigned node, EdgeLabel label);
+    /// Index of an object, allocated on first use
+    unsigned objToIndex(unsigned obj);
+
     DataMap predMap;   // holding predecessors
-    DataMap succMap;   // holding successors
+    DataMap succMap;   // holding successors, except PT
+
+    std::pmr::unordered_map<unsigned, WordSet> ptsMap;   ///< node -> PT successors as object indices
+    std::unordered_map<unsigned, unsigned> objIndex;   ///< object ID -> object index
+    std::vector<unsigned> objOfIndex;                  ///< object index -> object ID
+
+    std::unordered_map<unsigned, unsigned> repOf;                  ///< merged node -> representative
+    std::unordered_map<unsigned, std::vector<unsigned>> members;   ///< representative -> merged nodes
 };
 
 
@@ -111,6 +190,10 @@ template<class T>
 class WorkList
 {
 public:
+    explicit WorkList(std::pmr::memory_resource *mem = std::pmr::get_default_resource()) :
+            data_set(mem), data_list(mem)
+    {}
+
     /// Check whether the worklist is empty.
     inline bool empty() const
     { return data_list.empty(); }
@@ -146,8 +229,8 @@ public:
     }
 
 protected:
-    std::unordered_set<T> data_set;       ///< to avoid duplicate elements
-    std::deque<T> data_list;     ///< to access the elements at both the beginning and the end
+    std::pmr::unordered_set<T> data_set;       ///< to avoid duplicate elements
+    std::pmr::deque<T> data_list;     ///< to access the elements at both the beginning and the end
 };
 
 
@@ -156,11 +239,33 @@ protected:
  */
 class CFLR
 {
+    AnalysisArena arena;        ///< backs the graph and the worklist; declared first so it outlives them
     WorkList<CFLREdge> workList;
     CFLRGraph *graph;
+    std::string moduleName;     ///< names the result file
+    bool solved = false;        ///< whether solve() has run, so input edges need no reseeding
+
+    /// Add a derived edge and queue it, unless it is already in the graph
+    void derive(unsigned src, unsigned dst, EdgeLabel label);
+
+    /// Demand-driven query state, kept across queries (see query)
+    std::unordered_map<unsigned, CFLRGraph::NodeSet> demandPts;    ///< points-to sets of the demanded nodes
+    std::unordered_map<unsigned, CFLRGraph::NodeSet> demandFlow;   ///< x -> demanded nodes x's values flow to
+    std::unordered_map<unsigned, std::vector<unsigned>> demandLoads;   ///< pointer -> nodes loading through it
+    std::unordered_map<unsigned, std::vector<unsigned>> demandStores;  ///< pointer -> values stored through it
+    std::vector<unsigned> demandExpand;   ///< demanded nodes whose incoming edges are not visited yet
+    WorkList<unsigned> demandChanged;     ///< demanded nodes whose points-to set grew
+    bool demandedStores = false;          ///< whether every Store edge has been demanded
+
+    /// Mark node as demanded
+    void demand(unsigned node);
+    /// Record that the values of src flow to dst
+    void demandFlowTo(unsigned src, unsigned dst);
+    /// Derive flows from the stores through store to the loads through load if the two pointers may alias
+    void matchLoadStore(unsigned load, unsigned store);
 
 public:
-    CFLR() : graph(nullptr)
+    CFLR() : workList(arena.pool()), graph(nullptr)
     {}
 
     ~CFLR()
@@ -168,10 +273,36 @@ public:
 
     /// Build a graph from PAG
     void buildGraph(SVF::PAG *pag);
+    /// Build a graph from an SVFIR snapshot
+    void buildGraph(const SVFIRSnapshot &snapshot);
+    /// Merge copy cycles in the graph before solving (see CFLRGraph::collapseCopyCycles)
+    size_t collapseCopyCycles()
+    { return graph->collapseCopyCycles(); }
+    /**
+     * Insert an input edge (Addr, Copy, Store or Load), e.g. a newly resolved call or return copy.
+     * Once solve() has run, the next solve() processes only the work caused by the inserted edges and keeps every
+     * edge derived so far, which gives the same points-to sets (getAllPts) as solving the extended graph from
+     * scratch. Copy cycles are not collapsed again: a Copy edge that closes a new cycle leaves its nodes separate,
+     * so getMembers may differ from a from-scratch run with collapseCopyCycles.
+     */
+    void addEdge(unsigned src, unsigned dst, EdgeLabel label);
     /// The dynamic-programming CFL-reachability algorithm.
     void solve();
+    /**
+     * Points-to set of node, visiting only the edges its PT edges depend on; solve() is not needed.
+     * PT ::= AddrBar | VFBar PT is followed backwards from node, and a Load is matched with the Stores whose
+     * pointers may alias its own. Work is memoized across queries. The query stops after budget steps
+     * (0: no limit) and returns false, leaving the rest of the work to later queries; objs then holds part of the
+     * answer.
+     */
+    bool query(unsigned node, std::vector<unsigned> &objs, size_t budget = 0);
     /// Dump results into a file
     void dumpResult();
+    /// Print the statistics of the arena behind the graph and the worklist
+    void reportMemory(std::ostream &out) const
+    { arena.report(out, "CFLR"); }
+    /// The PT edges as points-to sets, ordered by pointer; feeds dumpResult and PointsToIndex
+    PointsToList getAllPts() const;
 };
 
 #endif //ANSWERS_A4HEADER_H
@@ -5,101 +5,269 @@
 
 #include "A4Header.h"
 
-CFLRGraph::CFLRGraph(SVF::SVFIR *pag)
+CFLRGraph::CFLRGraph(SVF::SVFIR *pag, std::pmr::memory_resource *mem) :
+        predMap(mem), succMap(mem), ptsMap(mem)
 {
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Addr))
-    {
-        addEdge(edge->getSrcID(), edge->getDstID(), Addr);
-        addEdge(edge->getDstID(), edge->getSrcID(), AddrBar);
-    }
+    for (auto &stmt : SVFIRSnapshot::collectStmts(pag))
+        addStmt(stmt);
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Copy))
-    {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
-    }
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Phi))
-    {
-        const SVF::PhiStmt *phi = SVF::SVFUtil::cast<SVF::PhiStmt>(edge);
-        for (const auto opVar : phi->getOpndVars())
-        {
-            addEdge(opVar->getId(), phi->getResID(), Copy);
-            addEdge(phi->getResID(), opVar->getId(), CopyBar);
-        }
-    }
+CFLRGraph::CFLRGraph(const SVFIRSnapshot &snapshot, std::pmr::memory_resource *mem) :
+        predMap(mem), succMap(mem), ptsMap(mem)
+{
+    for (auto stmt = snapshot.stmtBegin(); stmt != snapshot.stmtEnd(); ++stmt)
+        addStmt(*stmt);
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Select))
-    {
-        const SVF::SelectStmt *sel = SVF::SVFUtil::cast<SVF::SelectStmt>(edge);
-        for (const auto opVar : sel->getOpndVars())
-        {
-            addEdge(opVar->getId(), sel->getResID(), Copy);
-            addEdge(sel->getResID(), opVar->getId(), CopyBar);
-        }
-    }
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Call))
+void CFLRGraph::addStmt(const StmtRecord &stmt)
+{
+    switch (stmt.kind)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+    case SVF::SVFStmt::Addr:
+        addEdge(stmt.src, stmt.dst, Addr);
+        break;
+    case SVF::SVFStmt::Copy:
+    case SVF::SVFStmt::Phi:
+    case SVF::SVFStmt::Select:
+    case SVF::SVFStmt::Call:
+    case SVF::SVFStmt::Ret:
+    case SVF::SVFStmt::ThreadFork:
+    case SVF::SVFStmt::ThreadJoin:
+        addEdge(stmt.src, stmt.dst, Copy);
+        break;
+    case SVF::SVFStmt::Store:
+        addEdge(stmt.src, stmt.dst, Store);
+        break;
+    case SVF::SVFStmt::Load:
+        addEdge(stmt.src, stmt.dst, Load);
+        break;
+    default:
+        break;
     }
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Ret))
+
+bool CFLRGraph::hasEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+{
+    if (isBar(EdgeLabel))
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        std::swap(src, dst);
+        EdgeLabel = baseLabel(EdgeLabel);
     }
-
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::ThreadFork))
+    if (EdgeLabel == PT)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        auto it = objIndex.find(dst);
+        return it != objIndex.end() && pointsTo(src).test(it->second);
     }
+    return lookup(succMap, src, EdgeLabel).count(dst);
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::ThreadJoin))
+
+void CFLRGraph::addEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+{
+    if (isBar(EdgeLabel))
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        std::swap(src, dst);
+        EdgeLabel = baseLabel(EdgeLabel);
     }
+    if (EdgeLabel == PT)
+        ptsMap[src].set(objToIndex(dst));
+    else
+        succMap[src][EdgeLabel].insert(dst);
+    predMap[dst][EdgeLabel].insert(src);
+}
+
+
+const WordSet &CFLRGraph::pointsTo(unsigned node) const
+{
+    static const WordSet empty;
+    auto it = ptsMap.find(node);
+    return it == ptsMap.end() ? empty : it->second;
+}
+
+
+WordSet CFLRGraph::unionPointsTo(unsigned dst, unsigned src)
+{
+    if (src == dst)
+        return WordSet();
+    WordSet added = pointsTo(src).difference(pointsTo(dst));
+    if (added.empty())
+        return added;
+    ptsMap[dst].unionWith(added);
+    for (auto index : added)
+        predMap[objOfIndex[index]][PT].insert(dst);
+    return added;
+}
+
+
+unsigned CFLRGraph::objToIndex(unsigned obj)
+{
+    auto it = objIndex.emplace(obj, objOfIndex.size());
+    if (it.second)
+        objOfIndex.push_back(obj);
+    return it.first->second;
+}
+
+
+const CFLRGraph::NodeSet &CFLRGraph::successors(unsigned node, EdgeLabel label) const
+{
+    assert(label != PT && "PT successors are read with pointsTo");
+    if (isBar(label))
+        return lookup(predMap, node, baseLabel(label));
+    return lookup(succMap, node, label);
+}
+
 
-    // opt load and store
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Store))
+const CFLRGraph::NodeSet &CFLRGraph::predecessors(unsigned node, EdgeLabel label) const
+{
+    assert(label != PTBar && "PT successors are read with pointsTo");
+    if (isBar(label))
+        return lookup(succMap, node, baseLabel(label));
+    return lookup(predMap, node, label);
+}
+
+
+const CFLRGraph::NodeSet &CFLRGraph::lookup(const DataMap &map, unsigned node, EdgeLabel label)
+{
+    static const NodeSet empty;
+    auto nodeIt = map.find(node);
+    if (nodeIt == map.end())
+        return empty;
+    auto labelIt = nodeIt->second.find(label);
+    return labelIt == nodeIt->second.end() ? empty : labelIt->second;
+}
+
+
+size_t CFLRGraph::collapseCopyCycles()
+{
+    // Tarjan's algorithm over Copy edges, iterative so long copy chains cannot overflow the stack
+    const unsigned Unvisited = UINT_MAX;
+    std::unordered_map<unsigned, unsigned> order, low;
+    std::unordered_set<unsigned> onStack;
+    std::vector<unsigned> stack;
+    std::vector<std::pair<unsigned, std::vector<unsigned>>> frames;   // (node, copy successors left to visit)
+    unsigned counter = 0;
+    size_t merged = 0;
+
+    auto copySuccs = [&](unsigned node) {
+        const NodeSet &succs = lookup(succMap, node, Copy);
+        return std::vector<unsigned>(succs.begin(), succs.end());
+    };
+    auto orderOf = [&](unsigned node) {
+        auto it = order.find(node);
+        return it == order.end() ? Unvisited : it->second;
+    };
+
+    std::vector<unsigned> roots;
+    for (auto &nodeItr : succMap)
+        roots.push_back(nodeItr.first);
+    for (auto root : roots)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Store);
-        addEdge(edge->getDstID(), edge->getSrcID(), StoreBar);
+        if (orderOf(root) != Unvisited)
+            continue;
+        order[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack.insert(root);
+        frames.emplace_back(root, copySuccs(root));
+
+        while (!frames.empty())
+        {
+            unsigned v = frames.back().first;
+            auto &pending = frames.back().second;
+            if (!pending.empty())
+            {
+                unsigned w = pending.back();
+                pending.pop_back();
+                if (orderOf(w) == Unvisited)
+                {
+                    order[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    onStack.insert(w);
+                    frames.emplace_back(w, copySuccs(w));
+                }
+                else if (onStack.count(w))
+                    low[v] = std::min(low[v], order[w]);
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty())
+                low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+            if (low[v] != order[v])
+                continue;
+
+            std::vector<unsigned> scc;
+            unsigned w;
+            do
+            {
+                w = stack.back();
+                stack.pop_back();
+                onStack.erase(w);
+                scc.push_back(w);
+            } while (w != v);
+
+            // Objects keep their identity: their IDs are what points-to sets are made of
+            bool hasObject = false;
+            for (auto node : scc)
+                hasObject = hasObject || !lookup(succMap, node, Addr).empty();
+            if (scc.size() < 2 || hasObject)
+                continue;
+            std::sort(scc.begin(), scc.end());
+            for (auto node : scc)
+                repOf[node] = scc.front();
+            merged += scc.size() - 1;
+            members[scc.front()] = std::move(scc);
+        }
     }
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Load))
+    if (merged == 0)
+        return 0;
+
+    // Rebuild the graph over representatives
+    std::vector<CFLREdge> edges;
+    for (auto &nodeItr : succMap)
+        for (auto &lblItr : nodeItr.second)
+            for (auto dst : lblItr.second)
+                edges.emplace_back(getRep(nodeItr.first), getRep(dst), lblItr.first);
+    succMap.clear();
+    predMap.clear();
+    for (auto &edge : edges)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Load);
-        addEdge(edge->getDstID(), edge->getSrcID(), LoadBar);
+        if (edge.label != Copy || edge.src != edge.dst)
+            addEdge(edge.src, edge.dst, edge.label);
     }
+    return merged;
 }
 
 
-bool CFLRGraph::hasEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+const std::vector<unsigned> &CFLRGraph::getMembers(unsigned rep) const
 {
-    return succMap[src][EdgeLabel].count(dst);
+    static const std::vector<unsigned> none;
+    auto it = members.find(rep);
+    return it == members.end() ? none : it->second;
 }
 
 
-void CFLRGraph::addEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+void CFLR::buildGraph(SVF::PAG *pag)
 {
-    succMap[src][EdgeLabel].insert(dst);
-    predMap[dst][EdgeLabel].insert(src);
+    if (!graph)
+        graph = new CFLRGraph(pag, arena.pool());
+    moduleName = pag->getModuleIdentifier();
 }
 
 
-void CFLR::buildGraph(SVF::PAG *pag)
+void CFLR::buildGraph(const SVFIRSnapshot &snapshot)
 {
     if (!graph)
-        graph = new CFLRGraph(pag);
+        graph = new CFLRGraph(snapshot, arena.pool());
+    moduleName = snapshot.getModuleIdentifier();
 }
 
 
 void CFLR::dumpResult()
 {
-    std::string fname = SVF::PAG::getPAG()->getModuleIdentifier() + ".res.txt";
+    std::string fname = moduleName + ".res.txt";
     std::ofstream outFile(fname, std::ios::out);
     if (!outFile)
     {
@@ -107,25 +275,35 @@ void CFLR::dumpResult()
         return;
     }
 
-    // Collect S-edges
-    std::map<unsigned, std::set<unsigned >> edgeSet;  // ordered edge set
-    for (auto &nodeItr : graph->getSuccessorMap())
+    // Write S-edges
+    for (auto &srcItr : getAllPts())
     {
-        unsigned src = nodeItr.first;
-        for (auto &lblItr : nodeItr.second)
+        for (auto dst : srcItr.second)
         {
-            if (lblItr.first == PT)
-                for (auto dst : lblItr.second)
-                    edgeSet[src].insert(dst);
+            outFile << srcItr.first << '\t' << "points to" << '\t' << dst << std::endl;
         }
     }
+}
 
-    // Write S-edges
+
+PointsToList CFLR::getAllPts() const
+{
+    // Collect S-edges
+    std::map<unsigned, std::set<unsigned >> edgeSet;  // ordered edge set
+    for (auto &nodeItr : graph->getPointsToMap())
+    {
+        for (auto index : nodeItr.second)
+            edgeSet[nodeItr.first].insert(graph->toObj(index));
+    }
+
+    // Nodes merged by collapseCopyCycles share their representative's set
+    std::map<unsigned, std::vector<unsigned>> byNode;
     for (auto &srcItr : edgeSet)
     {
-        for (auto dst : srcItr.second)
-        {
-            outFile << srcItr.first << '\t' << "points to" << '\t' << dst << std::endl;
-        }
+        std::vector<unsigned> objs(srcItr.second.begin(), srcItr.second.end());
+        for (auto member : graph->getMembers(srcItr.first))
+            byNode[member] = objs;
+        byNode[srcItr.first] = std::move(objs);
     }
+    return PointsToList(byNode.begin(), byNode.end());
 }
\ No newline at end of file
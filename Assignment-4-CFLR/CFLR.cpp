@@ -4,17 +4,67 @@
  */
 
 #include "A4Header.h"
+#include "BatchDriver.h"
+
+#include <sstream>
 
 using namespace SVF;
 using namespace llvm;
 using namespace std;
 
-int main(int argc, char **argv)
+// The driver is left out when the solver is linked into cflr_test (see CMakeLists.txt)
+#ifndef CFLR_NO_MAIN
+static const Option<std::string> ReadSnapshot("read-snapshot",
+                                              "Build the graph from an SVFIR snapshot written by 'svfir' instead of bitcode", "");
+static const Option<std::string> Manifest("manifest",
+                                          "Batch mode: analyze every program listed in this file (one per line)", "");
+static const Option<std::string> QueryIndex("query-index",
+                                            "Write the PT edges to this file as a memory-mappable query index (see PointsToIndex.h)", "");
+static const Option<bool> CollapseCopies("collapse-copies",
+                                          "Merge cycles of copy edges into one node before solving", true);
+static const Option<std::string> Query("query",
+                                       "Answer points-to queries for these comma-separated nodes on demand instead of solving the whole graph", "");
+static const Option<u32_t> QueryBudget("query-budget", "Steps allowed per demand query (0: no limit)", 0);
+static const Option<bool> ArenaStats("arena-stats", "Print the statistics of the solver's memory arena after solving", false);
+static const Option<u32_t> BatchJobs("batch-jobs", "Number of programs analyzed concurrently in batch mode", 2);
+
+/// Answer -query on demand, or solve the whole graph and dump the result; returns the exit code
+static int solveGraph(CFLR &solver)
 {
-    auto moduleNameVec =
-            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
-                                     "[options] <input-bitcode...>");
+    if (CollapseCopies())
+        solver.collapseCopyCycles();
+
+    if (!Query().empty())
+    {
+        std::stringstream nodes(Query());
+        std::string node;
+        while (std::getline(nodes, node, ','))
+        {
+            std::vector<unsigned> objs;
+            bool done = solver.query(std::stoul(node), objs, QueryBudget());
+            std::cout << node << "\tpoints to\t{ ";
+            for (auto obj : objs)
+                std::cout << obj << " ";
+            std::cout << (done ? "}" : "} (budget exhausted)") << std::endl;
+        }
+        return 0;
+    }
 
+    solver.solve();
+    if (ArenaStats())
+        solver.reportMemory(std::cout);
+    solver.dumpResult();
+    if (!QueryIndex().empty() && !PointsToIndex::write(solver.getAllPts(), QueryIndex()))
+    {
+        std::cout << "error writing " << QueryIndex() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/// Build, solve and dump one program
+static int analyzeModule(const std::vector<std::string> &moduleNameVec)
+{
     LLVMModuleSet::buildSVFModule(moduleNameVec);
 
     SVFIRBuilder builder;
@@ -23,20 +73,262 @@ int main(int argc, char **argv)
 
     CFLR solver;
     solver.buildGraph(pag);
-    // TODO: complete this method
-    solver.solve();
-    solver.dumpResult();
+    int rc = solveGraph(solver);
 
     LLVMModuleSet::releaseLLVMModuleSet();
-    return 0;
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    auto moduleNameVec =
+            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
+                                     "[options] <input-bitcode...>");
+
+    if (!ReadSnapshot().empty())
+    {
+        SVFIRSnapshot snapshot;
+        if (!snapshot.open(ReadSnapshot()))
+        {
+            std::cout << "error reading snapshot " + ReadSnapshot() + "!!\n";
+            return 1;
+        }
+        CFLR solver;
+        solver.buildGraph(snapshot);
+        return solveGraph(solver);
+    }
+
+    if (!Manifest().empty())
+        return runBatch(Manifest(), BatchJobs(), analyzeModule) == 0 ? 0 : 1;
+    return analyzeModule(moduleNameVec);
+}
+#endif //CFLR_NO_MAIN
+
+
+/**
+ * The grammar, in normal form (A ::= B or A ::= B C); XBar is the reverse of X:
+ *   PT ::= AddrBar | VFBar PT          p points to o
+ *   VF ::= Copy | SV Load              a value flows from src to dst
+ *   SV ::= Store VA                    a value is stored into memory that dst loads from
+ *   VA ::= PT PTBar                    two pointers point to a common object
+ */
+struct BinaryRule
+{
+    EdgeLabel head, left, right;
+};
+
+static const BinaryRule BinaryRules[] = {
+        {PT, VFBar, PT},
+        {VF, SV, Load},
+        {SV, Store, VA},
+        {VA, PT, PTBar},
+};
+
+
+void CFLR::derive(unsigned src, unsigned dst, EdgeLabel label)
+{
+    if (graph->hasEdge(src, dst, label))
+        return;
+    graph->addEdge(src, dst, label);
+    workList.push(CFLREdge(src, dst, label));
+}
+
+
+void CFLR::addEdge(unsigned src, unsigned dst, EdgeLabel label)
+{
+    assert(!isBar(label) && "only input labels can be inserted");
+    // Objects keep their own IDs: collapseCopyCycles never merges them
+    if (label != Addr)
+        src = graph->getRep(src);
+    dst = graph->getRep(dst);
+    if ((label == Copy && src == dst) || graph->hasEdge(src, dst, label))
+        return;
+
+    // Demand-query results may miss what flows along the new edge
+    demandPts.clear();
+    demandFlow.clear();
+    demandLoads.clear();
+    demandStores.clear();
+    demandExpand.clear();
+    demandChanged.clear();
+    demandedStores = false;
+
+    // Before the first solve() the edge is picked up with the other inputs
+    if (solved)
+        derive(src, dst, label);
+    else
+        graph->addEdge(src, dst, label);
 }
 
 
 void CFLR::solve()
 {
-    // TODO: complete this function. The implementations of graph and worklist are provided.
-    //  You need to:
-    //  1. implement the grammar production rules into code;
-    //  2. implement the dynamic-programming CFL-reachability algorithm.
-    //  You may need to add your new methods to 'CFLRGraph' and 'CFLR'.
+    // Input edges seed the worklist on the first run; later runs only drain what addEdge queued
+    if (!solved)
+    {
+        std::vector<CFLREdge> inputs;
+        for (auto &nodeItr : graph->getSuccessorMap())
+            for (auto &lblItr : nodeItr.second)
+                for (auto dst : lblItr.second)
+                    inputs.emplace_back(nodeItr.first, dst, lblItr.first);
+        for (auto &edge : inputs)
+            workList.push(edge);
+        solved = true;
+    }
+
+    while (!workList.empty())
+    {
+        CFLREdge edge = workList.pop();
+
+        // Unary rules
+        if (edge.label == Addr)
+            derive(edge.dst, edge.src, PT);
+        else if (edge.label == Copy)
+            derive(edge.src, edge.dst, VF);
+
+        // Binary rules, for the edge and for its reverse (the XBar edge dst -> src)
+        for (const CFLREdge &view : {edge, CFLREdge(edge.dst, edge.src, edge.label | 1)})
+        {
+            for (const auto &rule : BinaryRules)
+            {
+                // PT ::= VFBar PT: the target gains the whole points-to set of the source, in one union
+                if (rule.left == view.label && rule.right == PT && rule.head == PT)
+                {
+                    for (auto index : graph->unionPointsTo(view.src, view.dst))
+                        workList.push(CFLREdge(view.src, graph->toObj(index), PT));
+                    continue;
+                }
+                // Copy the neighbours: deriving may insert into the set being walked
+                if (rule.left == view.label)
+                {
+                    const auto &next = graph->successors(view.dst, rule.right);
+                    for (auto dst : std::vector<unsigned>(next.begin(), next.end()))
+                        derive(view.src, dst, rule.head);
+                }
+                if (rule.right == view.label)
+                {
+                    const auto &prev = graph->predecessors(view.src, rule.left);
+                    for (auto src : std::vector<unsigned>(prev.begin(), prev.end()))
+                        derive(src, view.dst, rule.head);
+                }
+            }
+        }
+    }
+}
+
+
+bool CFLR::query(unsigned node, std::vector<unsigned> &objs, size_t budget)
+{
+    node = graph->getRep(node);
+    demand(node);
+
+    size_t steps = 0;
+    bool done = true;
+    while (!demandExpand.empty() || !demandChanged.empty())
+    {
+        if (budget && steps++ >= budget)
+        {
+            done = false;
+            break;
+        }
+
+        if (!demandExpand.empty())
+        {
+            // PT ::= AddrBar | VFBar PT, with VF ::= Copy | SV Load
+            unsigned n = demandExpand.back();
+            demandExpand.pop_back();
+            for (auto obj : graph->predecessors(n, Addr))
+                demandPts[n].insert(obj);
+            demandChanged.push(n);
+            for (auto src : std::vector<unsigned>(graph->predecessors(n, Copy).begin(),
+                                                  graph->predecessors(n, Copy).end()))
+                demandFlowTo(src, n);
+            for (auto ptr : graph->predecessors(n, Load))
+            {
+                demandLoads[ptr].push_back(n);
+                demand(ptr);
+                demandChanged.push(ptr);
+            }
+
+            // SV ::= Store VA: any store may feed a load, so loads demand the pointers of all stores
+            if (!demandedStores && !demandLoads.empty())
+            {
+                demandedStores = true;
+                for (auto &nodeItr : graph->getSuccessorMap())
+                {
+                    for (auto ptr : graph->successors(nodeItr.first, Store))
+                    {
+                        demandStores[ptr].push_back(nodeItr.first);
+                        demand(ptr);
+                    }
+                }
+            }
+            continue;
+        }
+
+        unsigned n = demandChanged.pop();
+        const auto &pts = demandPts[n];
+        for (auto dst : demandFlow[n])
+        {
+            auto &dstPts = demandPts[dst];
+            size_t before = dstPts.size();
+            dstPts.insert(pts.begin(), pts.end());
+            if (dstPts.size() != before)
+                demandChanged.push(dst);
+        }
+        if (demandLoads.count(n))
+        {
+            for (auto &storeItr : demandStores)
+                matchLoadStore(n, storeItr.first);
+        }
+        if (demandStores.count(n))
+        {
+            for (auto &loadItr : demandLoads)
+                matchLoadStore(loadItr.first, n);
+        }
+    }
+
+    const auto &pts = demandPts[node];
+    objs.assign(pts.begin(), pts.end());
+    std::sort(objs.begin(), objs.end());
+    return done;
+}
+
+
+void CFLR::demand(unsigned node)
+{
+    if (demandPts.emplace(node, CFLRGraph::NodeSet()).second)
+        demandExpand.push_back(node);
+}
+
+
+void CFLR::demandFlowTo(unsigned src, unsigned dst)
+{
+    if (src == dst || !demandFlow[src].insert(dst).second)
+        return;
+    demand(src);
+    demandChanged.push(src);
+}
+
+
+void CFLR::matchLoadStore(unsigned load, unsigned store)
+{
+    // VA ::= PT PTBar: the two pointers share an object
+    const auto &loadPts = demandPts[load], &storePts = demandPts[store];
+    const auto &small = loadPts.size() < storePts.size() ? loadPts : storePts;
+    const auto &large = loadPts.size() < storePts.size() ? storePts : loadPts;
+    bool alias = false;
+    for (auto obj : small)
+    {
+        if (large.count(obj))
+        {
+            alias = true;
+            break;
+        }
+    }
+    if (!alias)
+        return;
+    for (auto dst : demandLoads[load])
+        for (auto src : demandStores[store])
+            demandFlowTo(src, dst);
 }
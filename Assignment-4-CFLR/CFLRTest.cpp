@@ -0,0 +1,208 @@
+/**
+ * CFLRTest.cpp
+ *
+ * Cross-checks the CFL-reachability solver on small random programs. Every program is written as an SVFIR
+ * snapshot and solved several ways, which must all agree:
+ *   - a fresh solve() gives every pointer the points-to set of a plain Andersen fixpoint over the same statements;
+ *   - collapsing copy cycles before solving gives the same getAllPts() as solving without collapse;
+ *   - query() on every pointer gives its getAllPts() entry, with and without a step budget;
+ *   - solving half of the statements, then inserting the rest with addEdge() in batches and calling solve()
+ *     after each batch, gives the same getAllPts() as a fresh solve.
+ */
+
+#include "A4Header.h"
+
+#include <filesystem>
+#include <map>
+#include <random>
+#include <set>
+
+using Pts = std::map<unsigned, std::set<unsigned>>;
+
+static const unsigned NumPrograms = 300;
+static const unsigned QueryBudget = 3;
+
+/// Pointers are the nodes [0, numPtrs), objects are [numPtrs, 2 * numPtrs)
+static std::vector<StmtRecord> randomProgram(std::mt19937 &rng, unsigned numPtrs)
+{
+    static const SVF::SVFStmt::PEDGEK kinds[] = {SVF::SVFStmt::Addr, SVF::SVFStmt::Copy, SVF::SVFStmt::Copy,
+                                                 SVF::SVFStmt::Phi, SVF::SVFStmt::Store, SVF::SVFStmt::Load};
+    std::vector<StmtRecord> stmts;
+    unsigned numStmts = rng() % (4 * numPtrs);
+    for (unsigned i = 0; i < numStmts; ++i)
+    {
+        auto kind = kinds[rng() % (sizeof(kinds) / sizeof(kinds[0]))];
+        uint32_t src = kind == SVF::SVFStmt::Addr ? numPtrs + rng() % numPtrs : rng() % numPtrs;
+        stmts.push_back({(uint32_t) kind, src, (uint32_t) (rng() % numPtrs)});
+    }
+    return stmts;
+}
+
+static Pts toPts(const PointsToList &list)
+{
+    Pts pts;
+    for (auto &entry : list)
+        pts[entry.first].insert(entry.second.begin(), entry.second.end());
+    return pts;
+}
+
+/// The non-empty sets of the pointers in pts; PT edges are derived for pointers only, not for the objects
+/// that Stores write into
+static Pts onlyPointers(const Pts &pts, unsigned numPtrs)
+{
+    Pts pointers;
+    for (auto &entry : pts)
+    {
+        if (entry.first < numPtrs && !entry.second.empty())
+            pointers.insert(entry);
+    }
+    return pointers;
+}
+
+/// Inclusion-based points-to sets of the pointers of stmts, by naive iteration to a fixpoint
+static Pts referencePts(const std::vector<StmtRecord> &stmts, unsigned numPtrs)
+{
+    Pts pts;
+    bool changed = true;
+    auto add = [&](unsigned ptr, const std::set<unsigned> &objs) {
+        for (auto obj : objs)
+            changed |= pts[ptr].insert(obj).second;
+    };
+    while (changed)
+    {
+        changed = false;
+        for (auto &stmt : stmts)
+        {
+            if (stmt.kind == SVF::SVFStmt::Addr)
+                add(stmt.dst, {stmt.src});
+            else if (stmt.kind == SVF::SVFStmt::Store)
+            {
+                for (auto obj : std::set<unsigned>(pts[stmt.dst]))
+                    add(obj, std::set<unsigned>(pts[stmt.src]));
+            }
+            else if (stmt.kind == SVF::SVFStmt::Load)
+            {
+                for (auto obj : std::set<unsigned>(pts[stmt.src]))
+                    add(stmt.dst, std::set<unsigned>(pts[obj]));
+            }
+            else
+                add(stmt.dst, std::set<unsigned>(pts[stmt.src]));
+        }
+    }
+    return onlyPointers(pts, numPtrs);
+}
+
+static EdgeLabel labelOf(const StmtRecord &stmt)
+{
+    switch (stmt.kind)
+    {
+    case SVF::SVFStmt::Addr:
+        return Addr;
+    case SVF::SVFStmt::Store:
+        return Store;
+    case SVF::SVFStmt::Load:
+        return Load;
+    default:
+        return Copy;
+    }
+}
+
+/// Points-to sets of a fresh solve of the snapshot at path
+static Pts solveFresh(const std::string &path, bool collapse)
+{
+    SVFIRSnapshot snapshot;
+    snapshot.open(path);
+    CFLR solver;
+    solver.buildGraph(snapshot);
+    if (collapse)
+        solver.collapseCopyCycles();
+    solver.solve();
+    return toPts(solver.getAllPts());
+}
+
+/// Report a mismatch of program; returns false
+static bool fail(unsigned program, const std::string &what, const std::vector<StmtRecord> &stmts)
+{
+    std::cerr << "program " << program << ": " << what << "\n";
+    for (auto &stmt : stmts)
+        std::cerr << "  kind " << stmt.kind << ": " << stmt.src << " -> " << stmt.dst << "\n";
+    return false;
+}
+
+static bool checkProgram(unsigned program, const std::vector<StmtRecord> &stmts, unsigned numPtrs,
+                         const std::string &dir, std::mt19937 &rng)
+{
+    std::string path = dir + "/full.snapshot";
+    std::string halfPath = dir + "/half.snapshot";
+    if (!SVFIRSnapshot::write(stmts, "cflr_test", path))
+        return fail(program, "cannot write " + path, stmts);
+
+    Pts fresh = solveFresh(path, false);
+    if (onlyPointers(fresh, numPtrs) != referencePts(stmts, numPtrs))
+        return fail(program, "solve() differs from the reference fixpoint", stmts);
+    if (solveFresh(path, true) != fresh)
+        return fail(program, "solve() after collapseCopyCycles differs from solve()", stmts);
+
+    for (bool collapse : {false, true})
+    {
+        SVFIRSnapshot snapshot;
+        snapshot.open(path);
+        CFLR solver;
+        solver.buildGraph(snapshot);
+        if (collapse)
+            solver.collapseCopyCycles();
+        size_t budget = program % 2 ? QueryBudget : 0;
+        for (unsigned ptr = 0; ptr < numPtrs; ++ptr)
+        {
+            std::vector<unsigned> objs;
+            while (!solver.query(ptr, objs, budget))
+                objs.clear();
+            auto it = fresh.find(ptr);
+            if (std::set<unsigned>(objs.begin(), objs.end()) != (it == fresh.end() ? std::set<unsigned>() : it->second))
+                return fail(program, "query(" + std::to_string(ptr) + ") differs from getAllPts()", stmts);
+        }
+    }
+
+    size_t half = stmts.size() / 2;
+    if (!SVFIRSnapshot::write(std::vector<StmtRecord>(stmts.begin(), stmts.begin() + half), "cflr_test", halfPath))
+        return fail(program, "cannot write " + halfPath, stmts);
+    for (bool collapse : {false, true})
+    {
+        SVFIRSnapshot snapshot;
+        snapshot.open(halfPath);
+        CFLR solver;
+        solver.buildGraph(snapshot);
+        if (collapse)
+            solver.collapseCopyCycles();
+        solver.solve();
+        for (size_t next = half; next < stmts.size();)
+        {
+            size_t end = std::min(stmts.size(), next + 1 + rng() % 3);
+            for (; next < end; ++next)
+                solver.addEdge(stmts[next].src, stmts[next].dst, labelOf(stmts[next]));
+            solver.solve();
+        }
+        if (toPts(solver.getAllPts()) != fresh)
+            return fail(program, "addEdge() after solve() differs from a fresh solve", stmts);
+    }
+    return true;
+}
+
+int main()
+{
+    std::string dir = (std::filesystem::temp_directory_path() / ("cflr_test." + std::to_string(getpid()))).string();
+    std::filesystem::create_directories(dir);
+
+    std::mt19937 rng(7);
+    unsigned failures = 0;
+    for (unsigned program = 0; program < NumPrograms; ++program)
+    {
+        unsigned numPtrs = 2 + rng() % 12;
+        if (!checkProgram(program, randomProgram(rng, numPtrs), numPtrs, dir, rng))
+            ++failures;
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << NumPrograms - failures << "/" << NumPrograms << " programs agree" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
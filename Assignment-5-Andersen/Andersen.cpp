@@ -4,16 +4,18 @@
  */
 
 #include "A5Header.h"
+#include "BatchDriver.h"
 
 using namespace llvm;
 using namespace std;
 
-int main(int argc, char** argv)
-{
-    auto moduleNameVec =
-            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
-                                     "[options] <input-bitcode...>");
+static const SVF::Option<std::string> Manifest("manifest",
+        "Batch mode: analyze every program listed in this file (one per line)", "");
+static const SVF::Option<SVF::u32_t> BatchJobs("batch-jobs", "Number of programs analyzed concurrently in batch mode", 2);
 
+/// Build, solve and dump one program
+static int analyzeModule(const std::vector<std::string>& moduleNameVec)
+{
     SVF::LLVMModuleSet::buildSVFModule(moduleNameVec);
 
     SVF::SVFIRBuilder builder;
@@ -31,6 +33,17 @@ int main(int argc, char** argv)
 	return 0;
 }
 
+int main(int argc, char** argv)
+{
+    auto moduleNameVec =
+            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
+                                     "[options] <input-bitcode...>");
+
+    if (!Manifest().empty())
+        return runBatch(Manifest(), BatchJobs(), analyzeModule) == 0 ? 0 : 1;
+    return analyzeModule(moduleNameVec);
+}
+
 
 void Andersen::runPointerAnalysis()
 {
@@ -6,10 +6,128 @@
 #ifndef ANSWERS_A5HEADER_H
 #define ANSWERS_A5HEADER_H
 
+#include <array>
+#include <chrono>
+#include <climits>
+
 #include "SVF-LLVM/SVFIRBuilder.h"
+#include "AnalysisArena.h"
+#include "PointsToIndex.h"
+#include "SetKernels.h"
+
+/**
+ * Points-to sets of all nodes, hash-consed: every distinct set is stored once and nodes refer to it by ID.
+ * Sets are immutable, so updating a node rebinds it to another interned set; unions are memoized per pair of
+ * set IDs, and nodes with equal points-to sets share one copy.
+ *
+ * Nodes and objects are mapped to dense indices (in first-seen order unless setOrder is given); sets are bit
+ * vectors over object indices (unions run on the word kernels of SetKernels.h), and toObj/getObjs map them back
+ * to object IDs. A set spans words up to its highest object index, so the object order sets the size of every set.
+ */
+class PTS
+{
+public:
+    using SetID = unsigned;
+    using Set = WordSet;                 ///< object indices
+    static constexpr SetID EmptySet = 0;
+
+    /// Sets and their indexes are allocated from mem
+    explicit PTS(std::pmr::memory_resource *mem = std::pmr::get_default_resource()) :
+            sets(mem), setIndex(0, SetIDHash{this}, SetIDEqual{this}, mem), unionCache(mem)
+    { clear(); }
+
+    // setIndex refers back to this table
+    PTS(const PTS &) = delete;
+    PTS &operator=(const PTS &) = delete;
+
+    /// Lay out node and object indices in the given orders (others follow in first-seen order); call before any
+    /// set is filled
+    void setOrder(const std::vector<unsigned> &nodeOrder, const std::vector<unsigned> &objOrder);
+
+    /// ID of the points-to set of a node
+    inline SetID getID(unsigned node) const
+    {
+        if (node >= nodeIndex.size() || nodeIndex[node] == 0)
+            return EmptySet;
+        return nodeSets[nodeIndex[node] - 1];
+    }
+
+    inline const Set &getSet(SetID id) const
+    { return sets[id]; }
+
+    /// Object ID of an object index stored in a set
+    inline unsigned toObj(unsigned index) const
+    { return objOfIndex[index]; }
+
+    /// Object IDs a node points to, sorted
+    std::vector<unsigned> getObjs(unsigned node) const;
+
+    /// Add obj to the points-to set of node; returns true if the set changed
+    bool insert(unsigned node, unsigned obj);
+    /// Union the set 'other' into the points-to set of node; returns true if the set changed
+    bool unionWith(unsigned node, SetID other);
+    /// Union objects (IDs, in any order) into the points-to set of node; returns true if the set changed
+    bool unionWithObjs(unsigned node, const std::vector<unsigned> &objs);
+    /// Overwrite the points-to set of node with objects (IDs, in any order)
+    void assign(unsigned node, const std::vector<unsigned> &objs);
+
+    /// Drop all sets; the index layout is kept
+    void clear();
+
+    /// Nodes with a non-empty points-to set, ordered by ID
+    std::vector<unsigned> getNodes() const;
+
+    /// Number of distinct sets interned so far
+    inline size_t numSets() const
+    { return sets.size(); }
+
+    /// 64-bit words the distinct sets span in the current object layout
+    size_t numWords() const;
+    /// Words the same sets would span with object IDs as their indices
+    size_t numWordsInIDOrder() const;
+
+protected:
+    /// Stands for the set being looked up in setIndex, which is not stored yet
+    static constexpr SetID ProbeID = UINT_MAX;
+
+    /// The set a setIndex key refers to
+    inline const Set &keySet(SetID id) const
+    { return id == ProbeID ? *probe : sets[id]; }
+
+    // setIndex holds set IDs but hashes and compares the sets behind them, so each set is stored once, in sets
+    struct SetIDHash
+    {
+        const PTS *table;
+        size_t operator()(SetID id) const
+        { return table->keySet(id).hash(); }
+    };
+    struct SetIDEqual
+    {
+        const PTS *table;
+        bool operator()(SetID a, SetID b) const
+        { return a == b || table->keySet(a) == table->keySet(b); }
+    };
+
+    SetID intern(const Set &set);
+    SetID unionSets(SetID a, SetID b);
+    /// Set ID slot of a node, allocating its index on first use
+    SetID &slot(unsigned node);
+    /// Index of an object, allocated on first use
+    unsigned objToIndex(unsigned obj);
+    /// Set of the indices of objs
+    Set toIndexSet(const std::vector<unsigned> &objs);
+
+    std::pmr::deque<Set> sets;                                  ///< set ID -> set (a deque keeps references stable)
+    std::pmr::unordered_set<SetID, SetIDHash, SetIDEqual> setIndex;   ///< IDs of the sets, looked up by content
+    const Set *probe = nullptr;                                 ///< the set ProbeID stands for during a lookup
+    std::pmr::unordered_map<uint64_t, SetID> unionCache;        ///< (smaller ID, larger ID) -> union
+
+    std::vector<unsigned> nodeIndex;    ///< node ID -> node index + 1 (0: none yet)
+    std::vector<SetID> nodeSets;        ///< node index -> set ID
+    std::vector<unsigned> objIndex;     ///< object ID -> object index + 1 (0: none yet)
+    std::vector<unsigned> objOfIndex;   ///< object index -> object ID
+};
 
-/// Point-to set
-using PTS = std::map<unsigned, std::set<unsigned>>;
 
 /**
  * FIFO worklist
@@ -18,6 +136,10 @@ template<class T>
 class WorkList
 {
 public:
+    explicit WorkList(std::pmr::memory_resource *mem = std::pmr::get_default_resource()) :
+            data_set(mem), data_list(mem)
+    {}
+
     /// Check whether the worklist is empty.
     inline bool empty() const
     { return data_list.empty(); }
@@ -52,9 +174,13 @@ public:
         return data;
     }
 
+    /// The pending data, front first
+    inline const std::pmr::deque<T> &items() const
+    { return data_list; }
+
 protected:
-    std::unordered_set<T> data_set;       ///< to avoid duplicate elements
-    std::deque<T> data_list;     ///< to access the elements at both the beginning and the end
+    std::pmr::unordered_set<T> data_set;       ///< to avoid duplicate elements
+    std::pmr::deque<T> data_list;     ///< to access the elements at both the beginning and the end
 };
 
 
@@ -63,19 +189,347 @@ class Andersen
 {
 public:
     explicit Andersen(SVF::ConstraintGraph *consg) :
-            consg(consg)
+            consg(consg), pts(arena.pool()), workList(arena.pool()), derivedCopyEdges(arena.monotonic()),
+            fieldObjLog(arena.monotonic())
     {}
 
     /// Run pointer analysis
     void runPointerAnalysis();
+
+    /**
+     * Demand-driven mode: compute the points-to sets of just the given pointers by solving the part of the
+     * constraint graph they depend on. Nodes solved by an earlier query are reused, not re-derived.
+     * @param budget max nodes one query may add to the solved part (0 for unlimited)
+     * @return false if a query exceeded the budget; the whole program has then been solved instead
+     */
+    bool solveOnDemand(const std::vector<unsigned> &queries, unsigned budget);
+
+    /**
+     * Restrict the next runPointerAnalysis to the backward slice of roots: the nodes whose points-to sets can
+     * flow into a root through copy, gep, load and store constraints. Roots get the same result as an
+     * unrestricted solve; nodes outside the slice are neither seeded nor propagated to.
+     * @return the number of nodes in the slice
+     */
+    size_t sliceFrom(const std::vector<unsigned> &roots);
+
+    /// Further restrict the next runPointerAnalysis to nodes in allowed (intersected with any slice already set)
+    void restrictTo(const std::unordered_set<unsigned> &allowed);
+
+    /// Take the points-to set of a node from another analysis (e.g. Steensgaard) instead of solving it
+    void setPts(unsigned id, const std::set<unsigned> &objs)
+    { pts.assign(id, std::vector<unsigned>(objs.begin(), objs.end())); }
+
+    /**
+     * Lay out points-to set indices in breadth-first order of the copy/gep/load graph. Each search starts at a
+     * pointer of an address-of constraint, and the objects whose addresses the visited pointers take are numbered
+     * as they are reached, so objects that flow to the same pointers get neighbouring indices and the sets holding
+     * them span fewer words. Call before solving (after mergeEquivalentObjects, if used).
+     */
+    void renumber();
+
+    /**
+     * Merge location-equivalent objects: objects whose addresses are taken by exactly the same pointers are
+     * always pointed to together, so each such class is solved as its smallest member and expanded back to all
+     * members in the results. Call before solving.
+     * @return the number of objects merged into another
+     */
+    size_t mergeEquivalentObjects();
+
+    /**
+     * Bound field sensitivity: an object gets at most perObject field objects, and all objects together at most
+     * total (0 means unlimited). An object that exceeds either limit is collapsed to field-insensitive.
+     */
+    void setFieldLimits(unsigned perObject, unsigned total)
+    {
+        fieldLimit = perObject;
+        fieldBudget = total;
+    }
+    /**
+     * Save the solver state to path every interval seconds while solving (0: never), and stop solving once
+     * timeLimit seconds have passed from now (0: no limit), saving the state first. A later run of the same
+     * program with the same options can continue from the saved state with resume.
+     */
+    void setCheckpointing(const std::string &path, unsigned interval, unsigned timeLimit);
+    /**
+     * Continue a runPointerAnalysis from the checkpoint at path instead of starting over
+     * @return false if path holds no checkpoint of this program (nothing has been solved then)
+     */
+    bool resume(const std::string &path);
+    /// Whether the last solve stopped at the deadline, before reaching the fixpoint
+    bool stoppedAtDeadline() const
+    { return deadlineHit; }
+
+    /**
+     * Class-hierarchy pre-pass: add the callees of virtual call sites that class-hierarchy analysis resolves to
+     * at most maxTargets functions (0: any number) straight to cg. Such call sites need no points-to set, so the
+     * solver and updateCallGraph skip them.
+     * @return the number of call sites resolved
+     */
+    size_t resolveVirtualCalls(SVF::CallGraph *cg, unsigned maxTargets);
+    /// Whether resolveVirtualCalls already added the callees of cs
+    inline bool isPreResolved(const SVF::CallICFGNode *cs) const
+    { return preResolved.count(cs); }
+
     /// Update call graph
     void updateCallGraph(SVF::CallGraph* cg);
     /// Dump results into a file
     void dumpResult();
 
+    /// Points-to set of a node (empty if the node points to nothing)
+    std::vector<unsigned> getPts(unsigned id) const;
+    /// Points-to sets of all nodes that point to something, ordered by node; feeds dumpResult and PointsToIndex
+    PointsToList getAllPts() const;
+
+    SVF::ConstraintGraph *getConstraintGraph() const
+    { return consg; }
+
+    /// Print the statistics of the arena behind the points-to sets, worklist and derived-edge logs
+    void reportMemory(std::ostream &out) const
+    {
+        arena.report(out, "Andersen");
+        out << "Andersen points-to sets: " << pts.numSets() << " distinct, " << pts.numWords() << " words ("
+            << pts.numWordsInIDOrder() << " with object IDs as indices)" << std::endl;
+    }
+
 protected:
+    /// The object that stands for obj's location-equivalence class while solving
+    inline unsigned locRep(unsigned obj) const
+    {
+        auto it = objRep.find(obj);
+        return it == objRep.end() ? obj : it->second;
+    }
+    /// Replace every class representative in objs by all members of its class; the result is sorted
+    std::vector<unsigned> expandObjs(const std::vector<unsigned> &objs) const;
+
+    /// Propagate points-to sets until the worklist is empty
+    void solveWorkList();
+
+    /// Add root and everything its points-to set depends on to the demanded part of the graph
+    void demand(unsigned root);
+    /// A load was demanded: every store may write the loaded memory, so demand all stored values and pointers
+    void demandMemory(std::vector<unsigned> &pending);
+
+    inline bool inScope(unsigned id) const
+    { return !scoped || scope.count(id); }
+
+    /// A pointee touched by a load or store in a restricted solve; its contents are needed from now on
+    inline void requireObj(unsigned obj)
+    {
+        if (demandMode)
+            demand(obj);
+        else if (scoped)
+            scope.insert(obj);
+    }
+
+    /// Called between worklist steps: checkpoint when due; returns true once the deadline has passed
+    bool checkClock();
+    /// Write points-to sets, derived edges and field objects, scope and worklist to checkpointPath
+    bool writeCheckpoint() const;
+
+    /// Add a copy edge src -> dst unless it already exists; returns true if the edge is new
+    bool addCopyEdge(unsigned src, unsigned dst);
+    /// Create (or look up) the field object of obj for gep in the constraint graph, logging it for checkpoints
+    unsigned newFieldObj(unsigned obj, const SVF::GepCGEdge *gep);
+    /// Field object reached from obj through gep, memoized per (object, field offset), as its locRep
+    unsigned getFieldObj(unsigned obj, const SVF::GepCGEdge *gep);
+    /// Record a field object of base and collapse base once it exceeds the field limits
+    void trackFieldObj(unsigned base, unsigned fieldObj);
+    /// Make base field-insensitive: its existing fields and base share one points-to set from now on
+    void collapseObj(unsigned base);
+
     SVF::ConstraintGraph *consg;
+    AnalysisArena arena;    ///< backs pts, workList and the derived-edge logs; declared first so it outlives them
     PTS pts;
+    WorkList<unsigned> workList;
+    /// A field-object lookup: the object and the full constant offset, or variant for non-constant offsets
+    struct FieldKey
+    {
+        unsigned obj;
+        bool variant;
+        SVF::APOffset offset;
+
+        bool operator==(const FieldKey &rhs) const
+        { return obj == rhs.obj && variant == rhs.variant && offset == rhs.offset; }
+    };
+    struct FieldKeyHash
+    {
+        size_t operator()(const FieldKey &key) const
+        { return (((size_t) key.obj << 1 | key.variant) * 0x9E3779B97F4A7C15ULL) ^ (size_t) key.offset; }
+    };
+    std::unordered_map<FieldKey, unsigned, FieldKeyHash> fieldObjCache;   ///< field-object lookup -> field object
+
+    unsigned fieldLimit = 0;    ///< max field objects per object, 0 for unlimited
+    unsigned fieldBudget = 0;   ///< max field objects overall, 0 for unlimited
+    unsigned numFieldObjs = 0;
+    std::unordered_map<unsigned, std::set<unsigned>> objFields;   ///< base object -> its field objects
+    std::unordered_set<unsigned> collapsedObjs;
+
+    std::unordered_set<const SVF::CallICFGNode *> preResolved;    ///< call sites resolved by class hierarchy
+
+    std::unordered_map<unsigned, unsigned> objRep;                      ///< merged object -> representative
+    std::unordered_map<unsigned, std::vector<unsigned>> repMembers;     ///< representative -> class members
+
+    bool scoped = false;        ///< only nodes in scope are seeded and propagated to
+    std::unordered_set<unsigned> scope;
+    bool demandMode = false;    ///< the scope grows on demand
+    bool memoryDemanded = false;
+    bool budgetExceeded = false;
+    unsigned queryBudget = 0;
+    unsigned queryCost = 0;
+
+    using Clock = std::chrono::steady_clock;
+    std::string checkpointPath;
+    Clock::duration checkpointInterval = Clock::duration::zero();     ///< zero: no periodic checkpoints
+    Clock::time_point lastCheckpoint;
+    Clock::time_point deadline = Clock::time_point::max();
+    bool deadlineHit = false;
+    unsigned initialNodeNum = 0;    ///< constraint nodes before solving added any field object
+    std::pmr::deque<std::pair<unsigned, unsigned>> derivedCopyEdges;   ///< copy edges added while solving, in order
+    std::pmr::deque<std::array<unsigned, 3>> fieldObjLog;              ///< (object, gep src, gep dst), in creation order
+};
+
+
+/**
+ * Unification-based (Steensgaard) points-to analysis over the same constraint graph, in near-linear time.
+ * Nodes are partitioned into equivalence classes with a union-find; every class points to at most one class.
+ * Its results over-approximate Andersen's, so it can answer call resolution on its own or bound an Andersen solve.
+ */
+class Steensgaard
+{
+public:
+    explicit Steensgaard(SVF::ConstraintGraph *consg);
+
+    /// Unify along every constraint (one pass)
+    void solve();
+
+    /// Objects a node may point to
+    std::set<unsigned> getPts(unsigned id);
+
+    /// Nodes whose values may lead to a function through any number of dereferences; only these can
+    /// contribute to the points-to set of a function pointer
+    std::unordered_set<unsigned> functionRelevantNodes();
+
+protected:
+    static constexpr unsigned NoClass = UINT_MAX;
+
+    unsigned find(unsigned id);
+    void join(unsigned a, unsigned b);
+    /// The class pointed to by id's class, created empty if there is none yet
+    unsigned pointee(unsigned id);
+    unsigned newClass();
+
+    SVF::ConstraintGraph *consg;
+    std::vector<unsigned> parent;
+    std::vector<unsigned> rank;
+    std::vector<unsigned> pointsTo;     ///< class representative -> pointee class, NoClass if none
+    std::set<unsigned> objects;         ///< address-taken objects
+    std::unordered_map<unsigned, std::set<unsigned>> classObjects;    ///< class -> its objects, built on first query
+};
+
+
+/**
+ * Function reachability over a call graph. The graph is copied into compressed sparse row form (one offset
+ * array, one target array over dense function indices), collapsed into strongly connected components with
+ * Tarjan's algorithm, and reachability is propagated over the component DAG.
+ */
+class CallGraphReach
+{
+public:
+    explicit CallGraphReach(SVF::CallGraph *cg);
+
+    /**
+     * Mark the functions reachable from the named roots (names not in the program are ignored)
+     * @param openWorld also start from every function code outside the module may call: ones with non-local
+     *                  linkage and ones whose address is taken (qsort comparators, thread start routines, atexit
+     *                  handlers, function tables in escaping globals)
+     * @return the number of reachable functions
+     */
+    size_t computeReachable(const std::vector<std::string> &roots, bool openWorld = true);
+
+    /// Defined functions not reachable from any root, ordered by name
+    std::vector<const SVF::FunObjVar *> getUnreachable() const;
+
+    inline size_t numFunctions() const
+    { return funcs.size(); }
+
+    inline size_t numSCCs() const
+    { return sccMembers.size(); }
+
+    /**
+     * Write the main module with unreachable functions removed as bitcode: unused ones are erased, and
+     * ones still referenced (e.g. from a dead function table) keep their symbol with an unreachable body
+     */
+    bool writePrunedModule(const std::string &path) const;
+
+protected:
+    /// Tarjan's algorithm over the CSR graph, iterative so deep call chains cannot overflow the stack
+    void computeSCCs();
+    /// Whether function i may be called from outside the module, directly or through its address
+    bool isExternallyCallable(unsigned i) const;
+
+    std::vector<const SVF::FunObjVar *> funcs;      ///< function index -> function
+    std::vector<unsigned> offsets;                  ///< callees of function i: targets[offsets[i] .. offsets[i + 1])
+    std::vector<unsigned> targets;
+
+    std::vector<unsigned> sccOf;                    ///< function index -> SCC (SCCs are numbered callees first)
+    std::vector<std::vector<unsigned>> sccMembers;  ///< SCC -> function indices
+    std::vector<bool> reachable;                    ///< function index -> reachable from a root
+};
+
+
+/**
+ * Serves analysis queries over a local Unix socket, keeping the module and the solved state resident.
+ * Requests and replies are single lines:
+ *   resolve                 every indirect call site with its resolved callees
+ *   callees <callsite>      callees of one call site (ICFG node ID)
+ *   pts <node>              points-to set of a constraint node
+ *   alias <node> <node>     whether two constraint nodes may point to a common object
+ *   path <caller> <callee>  a shortest call chain between two functions
+ *   quit | shutdown         close this connection | stop the server
+ */
+class QueryServer
+{
+public:
+    QueryServer(const Andersen &andersen, SVF::CallGraph *cg) :
+            andersen(andersen), cg(cg)
+    { index.load(andersen.getAllPts()); }
+
+    /// Listen on socketPath until a client sends 'shutdown'; returns false if the socket cannot be set up
+    bool serve(const std::string &socketPath);
+
+protected:
+    enum class ClientState
+    {
+        Open, Closed, Shutdown
+    };
+
+    /// A connection: requests not answered yet and replies not sent yet
+    struct Client
+    {
+        std::string input;      ///< received bytes, starting with the first unanswered request
+        std::string output;     ///< replies the socket has not taken yet
+        bool quitting = false;  ///< sent 'quit': closed once output is sent
+    };
+
+    static constexpr size_t MaxRequestSize = 1 << 20;
+    /// A client with this many unsent reply bytes gets no more requests answered until it reads them
+    static constexpr size_t MaxPendingOutput = 1 << 20;
+
+    /// Handle what poll reported for a connection without blocking: read, answer complete requests, send replies
+    ClientState serveClient(int fd, short revents, Client &client);
+    /// Answer the complete requests in client.input until MaxPendingOutput bytes of replies are waiting
+    ClientState answerRequests(Client &client);
+    /// The poll events a connection waits for
+    static short pollEvents(const Client &client);
+    std::string answer(const std::string &request);
+
+    /// Names of the functions funPtr may point to
+    std::string resolve(unsigned funPtr);
+    std::string findPath(const std::string &from, const std::string &to);
+
+    const Andersen &andersen;
+    SVF::CallGraph *cg;
+    PointsToIndex index;    ///< answers pts and alias requests
 };
 
 
@@ -16,13 +16,822 @@ void Andersen::dumpResult()
     }
 
     // Write S-edges
-    for (auto &pointerIt : pts)
+    for (auto &entry : getAllPts())
     {
-        outFile << pointerIt.first << " points to: {";
-        for (auto pointee : pointerIt.second)
+        outFile << entry.first << " points to: {";
+        for (auto pointee : entry.second)
         {
             outFile << pointee << ", ";
         }
         outFile << "}\n";
     }
-}
\ No newline at end of file
+}
+
+
+PointsToList Andersen::getAllPts() const
+{
+    // Merged objects share the points-to set of their representative
+    std::vector<unsigned> pointers = pts.getNodes();
+    for (auto &cls : repMembers)
+    {
+        if (pts.getID(cls.first) != PTS::EmptySet)
+            pointers.insert(pointers.end(), cls.second.begin(), cls.second.end());
+    }
+    std::sort(pointers.begin(), pointers.end());
+    pointers.erase(std::unique(pointers.begin(), pointers.end()), pointers.end());
+
+    PointsToList all;
+    for (auto pointer : pointers)
+        all.emplace_back(pointer, getPts(pointer));
+    return all;
+}
+
+
+size_t Andersen::resolveVirtualCalls(SVF::CallGraph *cg, unsigned maxTargets)
+{
+    auto chg = SVF::PAG::getPAG()->getCHG();
+    if (!chg)
+        return 0;
+
+    for (const auto &entry : consg->getIndirectCallsites())
+    {
+        auto callNode = entry.first;
+        if (!callNode->isVirtualCall() || !chg->csHasVFnsBasedonCHA(callNode))
+            continue;
+        // Sites with many candidate overriders are left to the points-to analysis, which is more precise
+        const auto &targets = chg->getCSVFsBasedonCHA(callNode);
+        if (targets.empty() || (maxTargets && targets.size() > maxTargets))
+            continue;
+        for (auto callee : targets)
+            cg->addIndirectCallGraphEdge(callNode, callNode->getCaller(), callee);
+        preResolved.insert(callNode);
+    }
+    return preResolved.size();
+}
+
+
+std::vector<unsigned> Andersen::getPts(unsigned id) const
+{
+    return expandObjs(pts.getObjs(locRep(id)));
+}
+
+
+std::vector<unsigned> Andersen::expandObjs(const std::vector<unsigned> &objs) const
+{
+    if (repMembers.empty())
+        return objs;
+    std::vector<unsigned> expanded;
+    for (auto obj : objs)
+    {
+        auto it = repMembers.find(obj);
+        if (it == repMembers.end())
+            expanded.push_back(obj);
+        else
+            expanded.insert(expanded.end(), it->second.begin(), it->second.end());
+    }
+    std::sort(expanded.begin(), expanded.end());
+    return expanded;
+}
+
+
+size_t Andersen::mergeEquivalentObjects()
+{
+    // Object -> the pointers that take its address
+    std::map<unsigned, std::vector<unsigned>> takers;
+    for (auto &item : *consg)
+    {
+        for (auto edge : item.second->getAddrInEdges())
+            takers[edge->getSrcID()].push_back(item.first);
+    }
+
+    std::map<std::vector<unsigned>, std::vector<unsigned>> classes;
+    for (auto &objTakers : takers)
+    {
+        auto &ptrs = objTakers.second;
+        std::sort(ptrs.begin(), ptrs.end());
+        ptrs.erase(std::unique(ptrs.begin(), ptrs.end()), ptrs.end());
+        classes[ptrs].push_back(objTakers.first);
+    }
+
+    size_t merged = 0;
+    for (auto &cls : classes)
+    {
+        auto &members = cls.second;
+        if (members.size() < 2)
+            continue;
+        unsigned rep = members.front();     // the smallest ID, takers are visited in ID order
+        for (auto member : members)
+        {
+            if (member != rep)
+                objRep[member] = rep;
+        }
+        merged += members.size() - 1;
+        repMembers[rep] = members;
+    }
+    return merged;
+}
+
+
+void PTS::setOrder(const std::vector<unsigned> &nodeOrder, const std::vector<unsigned> &objOrder)
+{
+    nodeIndex.clear();
+    nodeSets.clear();
+    objIndex.clear();
+    objOfIndex.clear();
+    clear();
+    for (auto node : nodeOrder)
+        slot(node);
+    for (auto obj : objOrder)
+        objToIndex(obj);
+}
+
+
+void PTS::clear()
+{
+    sets.clear();
+    setIndex.clear();
+    unionCache.clear();
+    std::fill(nodeSets.begin(), nodeSets.end(), EmptySet);
+    intern(Set());
+}
+
+
+PTS::SetID &PTS::slot(unsigned node)
+{
+    if (node >= nodeIndex.size())
+        nodeIndex.resize(node + 1, 0);
+    if (nodeIndex[node] == 0)
+    {
+        nodeSets.push_back(EmptySet);
+        nodeIndex[node] = nodeSets.size();
+    }
+    return nodeSets[nodeIndex[node] - 1];
+}
+
+
+unsigned PTS::objToIndex(unsigned obj)
+{
+    if (obj >= objIndex.size())
+        objIndex.resize(obj + 1, 0);
+    if (objIndex[obj] == 0)
+    {
+        objOfIndex.push_back(obj);
+        objIndex[obj] = objOfIndex.size();
+    }
+    return objIndex[obj] - 1;
+}
+
+
+PTS::Set PTS::toIndexSet(const std::vector<unsigned> &objs)
+{
+    Set set;
+    for (auto obj : objs)
+        set.set(objToIndex(obj));
+    return set;
+}
+
+
+PTS::SetID PTS::intern(const Set &set)
+{
+    probe = &set;
+    auto it = setIndex.find(ProbeID);
+    probe = nullptr;
+    if (it != setIndex.end())
+        return *it;
+    SetID id = sets.size();
+    sets.push_back(set);
+    setIndex.insert(id);
+    return id;
+}
+
+
+PTS::SetID PTS::unionSets(SetID a, SetID b)
+{
+    if (a == b || b == EmptySet)
+        return a;
+    if (a == EmptySet)
+        return b;
+
+    uint64_t key = a < b ? ((uint64_t) a << 32) | b : ((uint64_t) b << 32) | a;
+    auto it = unionCache.find(key);
+    if (it != unionCache.end())
+        return it->second;
+
+    // One of the sets often already contains the other: then no new set is hashed or stored
+    Set merged = sets[a];
+    SetID id = merged.unionWith(sets[b]) ? intern(merged) : a;
+    unionCache.emplace(key, id);
+    return id;
+}
+
+
+std::vector<unsigned> PTS::getObjs(unsigned node) const
+{
+    std::vector<unsigned> objs;
+    for (auto index : getSet(getID(node)))
+        objs.push_back(objOfIndex[index]);
+    std::sort(objs.begin(), objs.end());
+    return objs;
+}
+
+
+size_t PTS::numWords() const
+{
+    size_t words = 0;
+    for (auto &set : sets)
+        words += set.getWords().size();
+    return words;
+}
+
+
+size_t PTS::numWordsInIDOrder() const
+{
+    size_t words = 0;
+    for (auto &set : sets)
+    {
+        unsigned maxObj = 0;
+        bool empty = true;
+        for (auto index : set)
+        {
+            maxObj = std::max(maxObj, objOfIndex[index]);
+            empty = false;
+        }
+        words += empty ? 0 : maxObj / 64 + 1;
+    }
+    return words;
+}
+
+
+std::vector<unsigned> PTS::getNodes() const
+{
+    std::vector<unsigned> nodes;
+    for (unsigned node = 0; node < nodeIndex.size(); ++node)
+    {
+        if (getID(node) != EmptySet)
+            nodes.push_back(node);
+    }
+    return nodes;
+}
+
+
+bool PTS::insert(unsigned node, unsigned obj)
+{
+    Set single;
+    single.set(objToIndex(obj));
+    return unionWith(node, intern(single));
+}
+
+
+bool PTS::unionWith(unsigned node, SetID other)
+{
+    SetID &cur = slot(node);
+    SetID merged = unionSets(cur, other);
+    if (merged == cur)
+        return false;
+    cur = merged;
+    return true;
+}
+
+
+bool PTS::unionWithObjs(unsigned node, const std::vector<unsigned> &objs)
+{
+    return unionWith(node, intern(toIndexSet(objs)));
+}
+
+
+void PTS::assign(unsigned node, const std::vector<unsigned> &objs)
+{
+    SetID id = intern(toIndexSet(objs));
+    slot(node) = id;
+}
+
+
+void Andersen::renumber()
+{
+    std::vector<unsigned> nodeOrder;
+    std::vector<unsigned> objOrder;
+    std::unordered_set<unsigned> seenNodes;
+    std::unordered_set<unsigned> seenObjs;
+    std::deque<unsigned> queue;
+
+    auto visit = [&](unsigned id) {
+        if (seenNodes.insert(id).second)
+        {
+            nodeOrder.push_back(id);
+            queue.push_back(id);
+        }
+    };
+
+    for (auto &item : *consg)
+    {
+        if (item.second->getAddrInEdges().empty() || seenNodes.count(item.first))
+            continue;
+        visit(item.first);
+        while (!queue.empty())
+        {
+            auto node = consg->getConstraintNode(queue.front());
+            queue.pop_front();
+            if (!node)
+                continue;
+            // Objects are numbered when the first pointer taking their address is reached
+            for (auto edge : node->getAddrInEdges())
+            {
+                unsigned obj = locRep(edge->getSrcID());
+                if (seenObjs.insert(obj).second)
+                    objOrder.push_back(obj);
+            }
+            for (auto edge : node->getCopyOutEdges())
+                visit(edge->getDstID());
+            for (auto edge : node->getGepOutEdges())
+                visit(edge->getDstID());
+            for (auto edge : node->getLoadOutEdges())
+                visit(edge->getDstID());
+        }
+    }
+
+    // Nodes no address flows to go last, in ID order; field objects made while solving get the next indices
+    for (auto &item : *consg)
+    {
+        if (seenNodes.insert(item.first).second)
+            nodeOrder.push_back(item.first);
+    }
+
+    pts.setOrder(nodeOrder, objOrder);
+}
+
+
+bool Andersen::addCopyEdge(unsigned src, unsigned dst)
+{
+    auto srcNode = consg->getConstraintNode(src);
+    if (!srcNode)
+        return false;
+
+    // Scan existing edges to avoid duplicates
+    for (auto edge : srcNode->getCopyOutEdges())
+    {
+        if (edge->getDstID() == dst)
+            return false;
+    }
+
+    consg->addCopyCGEdge(src, dst);
+    derivedCopyEdges.emplace_back(src, dst);
+    return true;
+}
+
+
+unsigned Andersen::newFieldObj(unsigned obj, const SVF::GepCGEdge *gep)
+{
+    unsigned before = consg->getTotalNodeNum();
+    unsigned fieldObj = consg->getGepObjVar(obj, gep);
+    // Field object IDs depend on creation order, which a resumed run has to replay
+    if (consg->getTotalNodeNum() != before)
+        fieldObjLog.push_back({obj, gep->getSrcID(), gep->getDstID()});
+    return fieldObj;
+}
+
+
+unsigned Andersen::getFieldObj(unsigned obj, const SVF::GepCGEdge *gep)
+{
+    // Every field of a field-insensitive object is its base: the node getGepObjVar would return, without the query.
+    // A base merged by mergeEquivalentObjects is solved as its representative, so it is returned as that.
+    if (SVF::PAG::getPAG()->getBaseObject(obj)->isFieldInsensitive())
+        return locRep(consg->getFIObjVar(obj));
+
+    bool limited = fieldLimit || fieldBudget;
+    if (limited && collapsedObjs.count(consg->getFIObjVar(obj)))
+        return locRep(consg->getFIObjVar(obj));
+
+    // Variant (non-constant) offsets all map to the field-insensitive object, so they share one cache slot;
+    // constant offsets are keyed in full, negative and byte offsets included
+    FieldKey key{obj, true, 0};
+    if (auto normalGep = SVF::SVFUtil::dyn_cast<SVF::NormalGepCGEdge>(gep))
+        key = {obj, false, normalGep->getConstantFieldIdx()};
+
+    auto it = fieldObjCache.find(key);
+    if (it != fieldObjCache.end())
+        return it->second;
+
+    unsigned fieldObj = locRep(newFieldObj(obj, gep));
+    if (limited)
+    {
+        unsigned base = consg->getFIObjVar(obj);
+        trackFieldObj(base, fieldObj);
+        if (collapsedObjs.count(base))
+            return locRep(base);
+    }
+    fieldObjCache.emplace(key, fieldObj);
+    return fieldObj;
+}
+
+
+void Andersen::trackFieldObj(unsigned base, unsigned fieldObj)
+{
+    if (fieldObj == base)
+        return;
+
+    auto &fields = objFields[base];
+    if (fields.insert(fieldObj).second)
+        ++numFieldObjs;
+
+    if ((fieldLimit && fields.size() > fieldLimit) || (fieldBudget && numFieldObjs > fieldBudget))
+        collapseObj(base);
+}
+
+
+void Andersen::collapseObj(unsigned base)
+{
+    if (!collapsedObjs.insert(base).second)
+        return;
+
+    // Tie every existing field to the base in both directions, so values stored into any of them (before or
+    // after collapsing) reach all of them, and pointers that already hold a field object stay sound.
+    // A merged base holds its contents in its representative.
+    unsigned node = locRep(base);
+    requireObj(node);
+    for (auto field : objFields[base])
+    {
+        requireObj(field);
+        if (addCopyEdge(field, node))
+            workList.push(field);
+        if (addCopyEdge(node, field))
+            workList.push(node);
+    }
+}
+
+
+bool Andersen::solveOnDemand(const std::vector<unsigned> &queries, unsigned budget)
+{
+    scoped = demandMode = true;
+    fieldObjCache.reserve(consg->getTotalNodeNum());
+    for (auto query : queries)
+    {
+        queryBudget = budget;
+        queryCost = 0;
+        demand(query);
+        solveWorkList();
+        if (budgetExceeded)
+            break;
+    }
+    scoped = demandMode = false;
+    if (!budgetExceeded)
+        return true;
+
+    // Partial results are a subset of the fixpoint but not all of them reach the worklist again, so start over.
+    // Copy edges derived so far stay valid.
+    budgetExceeded = false;
+    pts.clear();
+    runPointerAnalysis();
+    return false;
+}
+
+
+void Andersen::demand(unsigned root)
+{
+    std::vector<unsigned> pending = {root};
+    while (!pending.empty() && !budgetExceeded)
+    {
+        unsigned id = pending.back();
+        pending.pop_back();
+        if (!scope.insert(id).second)
+            continue;
+        if (queryBudget && ++queryCost > queryBudget)
+        {
+            budgetExceeded = true;
+            return;
+        }
+
+        auto node = consg->getConstraintNode(id);
+        if (!node)
+            continue;
+        workList.push(id);
+
+        for (auto edge : node->getAddrInEdges())
+            pts.insert(id, locRep(edge->getSrcID()));
+
+        // An already demanded predecessor has to run again to propagate into the new node
+        auto demandSrc = [&](const SVF::ConstraintEdge *edge) {
+            if (scope.count(edge->getSrcID()))
+                workList.push(edge->getSrcID());
+            else
+                pending.push_back(edge->getSrcID());
+        };
+        for (auto edge : node->getCopyInEdges())
+            demandSrc(edge);
+        for (auto edge : node->getGepInEdges())
+            demandSrc(edge);
+        for (auto edge : node->getLoadInEdges())
+            demandSrc(edge);
+
+        if (!node->getLoadInEdges().empty())
+            demandMemory(pending);
+    }
+}
+
+
+void Andersen::demandMemory(std::vector<unsigned> &pending)
+{
+    if (memoryDemanded)
+        return;
+    memoryDemanded = true;
+
+    for (auto &item : *consg)
+    {
+        for (auto edge : item.second->getStoreInEdges())
+        {
+            pending.push_back(edge->getSrcID());
+            pending.push_back(edge->getDstID());
+        }
+    }
+}
+
+
+size_t Andersen::sliceFrom(const std::vector<unsigned> &roots)
+{
+    scoped = true;
+    scope.clear();
+    bool memoryAdded = false;
+
+    std::vector<unsigned> pending(roots.begin(), roots.end());
+    while (!pending.empty())
+    {
+        unsigned id = pending.back();
+        pending.pop_back();
+        if (!scope.insert(id).second)
+            continue;
+        auto node = consg->getConstraintNode(id);
+        if (!node)
+            continue;
+
+        // Address-taken objects are kept so that loads and stores through them are solved as well
+        for (auto edge : node->getAddrInEdges())
+            pending.push_back(edge->getSrcID());
+        for (auto edge : node->getCopyInEdges())
+            pending.push_back(edge->getSrcID());
+        for (auto edge : node->getGepInEdges())
+            pending.push_back(edge->getSrcID());
+        for (auto edge : node->getLoadInEdges())
+            pending.push_back(edge->getSrcID());
+
+        // Any store may write the memory a load reads
+        if (!memoryAdded && !node->getLoadInEdges().empty())
+        {
+            memoryAdded = true;
+            for (auto &item : *consg)
+            {
+                for (auto store : item.second->getStoreInEdges())
+                {
+                    pending.push_back(store->getSrcID());
+                    pending.push_back(store->getDstID());
+                }
+            }
+        }
+    }
+    return scope.size();
+}
+
+
+void Andersen::restrictTo(const std::unordered_set<unsigned> &allowed)
+{
+    if (!scoped)
+    {
+        scoped = true;
+        scope = allowed;
+        return;
+    }
+    for (auto it = scope.begin(); it != scope.end();)
+    {
+        if (allowed.count(*it))
+            ++it;
+        else
+            it = scope.erase(it);
+    }
+}
+
+
+static const uint32_t CheckpointMagic = 0x4B435641;     // "AVCK"
+static const uint32_t CheckpointVersion = 1;
+
+static void putWord(std::ostream &out, uint32_t word)
+{
+    out.write(reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+static bool getWord(std::istream &in, uint32_t &word)
+{
+    return (bool) in.read(reinterpret_cast<char *>(&word), sizeof(word));
+}
+
+static void putList(std::ostream &out, const std::vector<unsigned> &list)
+{
+    putWord(out, list.size());
+    for (auto word : list)
+        putWord(out, word);
+}
+
+static bool getList(std::istream &in, std::vector<unsigned> &list)
+{
+    uint32_t size;
+    if (!getWord(in, size))
+        return false;
+    list.clear();
+    for (uint32_t word; list.size() < size && getWord(in, word);)
+        list.push_back(word);
+    return list.size() == size;
+}
+
+
+void Andersen::setCheckpointing(const std::string &path, unsigned interval, unsigned timeLimit)
+{
+    checkpointPath = path;
+    checkpointInterval = std::chrono::seconds(interval);
+    lastCheckpoint = Clock::now();
+    deadline = timeLimit ? lastCheckpoint + std::chrono::seconds(timeLimit) : Clock::time_point::max();
+}
+
+
+bool Andersen::checkClock()
+{
+    auto now = Clock::now();
+    if (now >= deadline)
+    {
+        deadlineHit = true;
+        writeCheckpoint();
+        return true;
+    }
+    if (checkpointInterval != Clock::duration::zero() && now - lastCheckpoint >= checkpointInterval)
+    {
+        writeCheckpoint();
+        lastCheckpoint = now;
+    }
+    return false;
+}
+
+
+bool Andersen::writeCheckpoint() const
+{
+    if (checkpointPath.empty())
+        return false;
+
+    // Write a new file and rename it over the old one, so a run killed mid-write keeps the previous checkpoint
+    std::string tmpPath = checkpointPath + ".tmp";
+    std::ofstream out(tmpPath, std::ios::out | std::ios::binary);
+    if (!out)
+        return false;
+
+    const std::string &moduleId = SVF::PAG::getPAG()->getModuleIdentifier();
+    putWord(out, CheckpointMagic);
+    putWord(out, CheckpointVersion);
+    putList(out, std::vector<unsigned>(moduleId.begin(), moduleId.end()));
+    putWord(out, initialNodeNum);
+    putWord(out, consg->getTotalNodeNum());
+
+    putWord(out, fieldObjLog.size());
+    for (auto &field : fieldObjLog)
+        for (auto word : field)
+            putWord(out, word);
+    putWord(out, derivedCopyEdges.size());
+    for (auto &edge : derivedCopyEdges)
+    {
+        putWord(out, edge.first);
+        putWord(out, edge.second);
+    }
+
+    putWord(out, objFields.size());
+    for (auto &fields : objFields)
+    {
+        putWord(out, fields.first);
+        putList(out, std::vector<unsigned>(fields.second.begin(), fields.second.end()));
+    }
+    putList(out, std::vector<unsigned>(collapsedObjs.begin(), collapsedObjs.end()));
+    putList(out, scoped ? std::vector<unsigned>(scope.begin(), scope.end()) : std::vector<unsigned>());
+
+    auto nodes = pts.getNodes();
+    putWord(out, nodes.size());
+    for (auto node : nodes)
+    {
+        putWord(out, node);
+        putList(out, pts.getObjs(node));
+    }
+    putList(out, std::vector<unsigned>(workList.items().begin(), workList.items().end()));
+
+    out.close();
+    return out && std::rename(tmpPath.c_str(), checkpointPath.c_str()) == 0;
+}
+
+
+bool Andersen::resume(const std::string &path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    uint32_t magic, version, nodeNum, finalNodeNum;
+    std::vector<unsigned> moduleId;
+    if (!in || !getWord(in, magic) || magic != CheckpointMagic || !getWord(in, version) ||
+        version != CheckpointVersion || !getList(in, moduleId))
+        return false;
+    const std::string &curModuleId = SVF::PAG::getPAG()->getModuleIdentifier();
+    if (std::string(moduleId.begin(), moduleId.end()) != curModuleId || !getWord(in, nodeNum) ||
+        nodeNum != consg->getTotalNodeNum() || !getWord(in, finalNodeNum))
+        return false;
+
+    // Read everything before touching the solver, so an unusable file leaves it as it was
+    uint32_t size;
+    std::vector<std::array<unsigned, 3>> fields;
+    for (getWord(in, size); in && fields.size() < size;)
+    {
+        std::array<unsigned, 3> field;
+        if (getWord(in, field[0]) && getWord(in, field[1]) && getWord(in, field[2]))
+            fields.push_back(field);
+    }
+    std::vector<std::pair<unsigned, unsigned>> edges;
+    for (getWord(in, size); in && edges.size() < size;)
+    {
+        uint32_t src, dst;
+        if (getWord(in, src) && getWord(in, dst))
+            edges.emplace_back(src, dst);
+    }
+    std::unordered_map<unsigned, std::set<unsigned>> savedFields;
+    for (getWord(in, size); in && savedFields.size() < size;)
+    {
+        uint32_t base;
+        std::vector<unsigned> list;
+        if (getWord(in, base) && getList(in, list))
+            savedFields[base].insert(list.begin(), list.end());
+    }
+    std::vector<unsigned> collapsed, savedScope, pending;
+    getList(in, collapsed);
+    getList(in, savedScope);
+    std::vector<std::pair<unsigned, std::vector<unsigned>>> savedPts;
+    for (getWord(in, size); in && savedPts.size() < size;)
+    {
+        uint32_t node;
+        std::vector<unsigned> objs;
+        if (getWord(in, node) && getList(in, objs))
+            savedPts.emplace_back(node, std::move(objs));
+    }
+    if (!getList(in, pending))
+        return false;
+
+    // Check the whole file against the graph before changing anything: field objects get their IDs in creation
+    // order and each replayed one adds exactly one node, so the file must name an existing GEP edge for every
+    // logged field object and account for every node above nodeNum
+    if (finalNodeNum != nodeNum + fields.size())
+        return false;
+    std::vector<const SVF::GepCGEdge *> geps;
+    for (auto &field : fields)
+    {
+        auto srcNode = consg->hasConstraintNode(field[1]) ? consg->getConstraintNode(field[1]) : nullptr;
+        if (!srcNode)
+            return false;
+        const SVF::GepCGEdge *gep = nullptr;
+        for (auto edge : srcNode->getGepOutEdges())
+        {
+            if (edge->getDstID() == field[2])
+                gep = SVF::SVFUtil::dyn_cast<SVF::GepCGEdge>(edge);
+        }
+        if (!gep)
+            return false;
+        geps.push_back(gep);
+    }
+    auto known = [&](unsigned node) { return node < finalNodeNum; };
+    for (auto &edge : edges)
+    {
+        if (!known(edge.first) || !known(edge.second))
+            return false;
+    }
+    for (auto &saved : savedPts)
+    {
+        if (!known(saved.first))
+            return false;
+    }
+    for (auto &saved : savedFields)
+    {
+        if (!known(saved.first) || !std::all_of(saved.second.begin(), saved.second.end(), known))
+            return false;
+    }
+    if (!std::all_of(collapsed.begin(), collapsed.end(), known) ||
+        !std::all_of(pending.begin(), pending.end(), known))
+        return false;
+
+    initialNodeNum = nodeNum;
+    for (size_t i = 0; i < fields.size(); ++i)
+        newFieldObj(fields[i][0], geps[i]);
+    assert(consg->getTotalNodeNum() == finalNodeNum && "replayed field objects differ from the checkpoint");
+
+    for (auto &edge : edges)
+        addCopyEdge(edge.first, edge.second);
+    for (auto &saved : savedFields)
+    {
+        numFieldObjs += saved.second.size();
+        objFields[saved.first] = std::move(saved.second);
+    }
+    collapsedObjs.insert(collapsed.begin(), collapsed.end());
+    if (scoped)
+        scope.insert(savedScope.begin(), savedScope.end());
+    for (auto &saved : savedPts)
+        pts.assign(saved.first, saved.second);
+
+    workList.clear();
+    for (auto node : pending)
+        workList.push(node);
+    solveWorkList();
+    return true;
+}
@@ -0,0 +1,180 @@
+/**
+ * CallGraphReach.cpp
+ * @author kisslune
+ */
+
+#include "A6Header.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Instructions.h"
+
+CallGraphReach::CallGraphReach(SVF::CallGraph *cg)
+{
+    std::unordered_map<unsigned, unsigned> index;   // call graph node ID -> function index
+    for (auto &it : *cg)
+    {
+        index[it.first] = funcs.size();
+        funcs.push_back(it.second->getFunction());
+    }
+
+    offsets.push_back(0);
+    for (auto &it : *cg)
+    {
+        size_t begin = targets.size();
+        for (auto edge : it.second->getOutEdges())
+            targets.push_back(index[edge->getDstID()]);
+        // Several call sites may call the same function; keep each callee once
+        std::sort(targets.begin() + begin, targets.end());
+        targets.erase(std::unique(targets.begin() + begin, targets.end()), targets.end());
+        offsets.push_back(targets.size());
+    }
+
+    computeSCCs();
+}
+
+
+void CallGraphReach::computeSCCs()
+{
+    const unsigned Unvisited = UINT_MAX;
+    unsigned n = funcs.size();
+    std::vector<unsigned> order(n, Unvisited), low(n, 0);
+    std::vector<bool> onStack(n, false);
+    std::vector<unsigned> stack;
+    std::vector<std::pair<unsigned, unsigned>> frames;    // (function, next edge to look at)
+    unsigned counter = 0;
+
+    sccOf.assign(n, Unvisited);
+    sccMembers.clear();
+    for (unsigned root = 0; root < n; ++root)
+    {
+        if (order[root] != Unvisited)
+            continue;
+        frames.emplace_back(root, offsets[root]);
+        order[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = true;
+
+        while (!frames.empty())
+        {
+            unsigned v = frames.back().first;
+            unsigned &next = frames.back().second;
+            if (next < offsets[v + 1])
+            {
+                unsigned w = targets[next++];
+                if (order[w] == Unvisited)
+                {
+                    order[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = true;
+                    frames.emplace_back(w, offsets[w]);
+                }
+                else if (onStack[w])
+                    low[v] = std::min(low[v], order[w]);
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty())
+                low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+            if (low[v] != order[v])
+                continue;
+
+            // v is the root of an SCC: pop its members
+            sccMembers.emplace_back();
+            unsigned w;
+            do
+            {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                sccOf[w] = sccMembers.size() - 1;
+                sccMembers.back().push_back(w);
+            } while (w != v);
+        }
+    }
+}
+
+
+bool CallGraphReach::isExternallyCallable(unsigned i) const
+{
+    auto module = SVF::LLVMModuleSet::getLLVMModuleSet()->getMainLLVMModule();
+    llvm::Function *fun = module ? module->getFunction(funcs[i]->getName()) : nullptr;
+    // A function the main module does not define (e.g. one from another input) is assumed callable
+    return !fun || !fun->hasLocalLinkage() || fun->hasAddressTaken();
+}
+
+
+size_t CallGraphReach::computeReachable(const std::vector<std::string> &roots, bool openWorld)
+{
+    std::unordered_set<std::string> rootNames(roots.begin(), roots.end());
+    std::vector<bool> sccReachable(sccMembers.size(), false);
+    for (unsigned i = 0; i < funcs.size(); ++i)
+    {
+        if (rootNames.count(funcs[i]->getName()) || (openWorld && isExternallyCallable(i)))
+            sccReachable[sccOf[i]] = true;
+    }
+
+    // Tarjan numbers an SCC only after all SCCs it calls, so callers come last: walk SCCs from last to first
+    for (unsigned scc = sccMembers.size(); scc-- > 0;)
+    {
+        if (!sccReachable[scc])
+            continue;
+        for (auto v : sccMembers[scc])
+            for (unsigned e = offsets[v]; e < offsets[v + 1]; ++e)
+                sccReachable[sccOf[targets[e]]] = true;
+    }
+
+    size_t numReachable = 0;
+    reachable.assign(funcs.size(), false);
+    for (unsigned i = 0; i < funcs.size(); ++i)
+    {
+        reachable[i] = sccReachable[sccOf[i]];
+        numReachable += reachable[i];
+    }
+    return numReachable;
+}
+
+
+std::vector<const SVF::FunObjVar *> CallGraphReach::getUnreachable() const
+{
+    std::vector<const SVF::FunObjVar *> unreachable;
+    for (unsigned i = 0; i < funcs.size(); ++i)
+    {
+        if (i < reachable.size() && !reachable[i] && !funcs[i]->isDeclaration())
+            unreachable.push_back(funcs[i]);
+    }
+    std::sort(unreachable.begin(), unreachable.end(),
+              [](const SVF::FunObjVar *a, const SVF::FunObjVar *b) { return a->getName() < b->getName(); });
+    return unreachable;
+}
+
+
+bool CallGraphReach::writePrunedModule(const std::string &path) const
+{
+    auto module = SVF::LLVMModuleSet::getLLVMModuleSet()->getMainLLVMModule();
+    if (!module)
+        return false;
+
+    for (auto func : getUnreachable())
+    {
+        llvm::Function *fun = module->getFunction(func->getName());
+        if (!fun || fun->isDeclaration())
+            continue;
+        if (fun->use_empty())
+        {
+            fun->eraseFromParent();
+            continue;
+        }
+        auto linkage = fun->getLinkage();
+        fun->deleteBody();
+        auto entry = llvm::BasicBlock::Create(fun->getContext(), "", fun);
+        new llvm::UnreachableInst(fun->getContext(), entry);
+        fun->setLinkage(linkage);
+    }
+
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec)
+        return false;
+    llvm::WriteBitcodeToFile(*module, out);
+    return true;
+}
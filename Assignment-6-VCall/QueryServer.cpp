@@ -0,0 +1,305 @@
+/**
+ * QueryServer.cpp
+ * @author kisslune
+ */
+
+#include "A6Header.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// Send as much of data as the non-blocking socket takes and drop it from data; false once the peer is gone
+static bool sendSome(int fd, std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        // MSG_NOSIGNAL: a client that disconnected early must not kill the server with SIGPIPE
+        ssize_t len = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (len <= 0)
+            return false;
+        sent += len;
+    }
+    data.erase(0, sent);
+    return true;
+}
+
+
+bool QueryServer::serve(const std::string &socketPath)
+{
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path))
+    {
+        std::cout << "socket path too long: " + socketPath + "\n";
+        return false;
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        return false;
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(listenFd, 8) != 0)
+    {
+        std::cout << "error listening on " + socketPath + "!!\n";
+        close(listenFd);
+        return false;
+    }
+    std::cout << "serving queries on " << socketPath << std::endl;
+
+    // One poll loop serves every connection and no socket call blocks, so a slow or idle client does not hold
+    // up the others: replies wait in the client's output until poll reports the socket writable.
+    // fds[0] is the listening socket; clients[i] is the state of fds[i].
+    std::vector<pollfd> fds{{listenFd, POLLIN, 0}};
+    std::vector<Client> clients(1);
+    unsigned acceptFailures = 0;
+    bool running = true;
+    while (running)
+    {
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cout << "error polling: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd >= 0)
+            {
+                acceptFailures = 0;
+                fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK);
+                fds.push_back({clientFd, POLLIN, 0});
+                clients.emplace_back();
+            }
+            else if (errno == EBADF || errno == EINVAL || errno == ENOTSOCK)
+            {
+                std::cout << "error accepting: " << std::strerror(errno) << std::endl;
+                break;
+            }
+            else if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED)
+            {
+                // Out of descriptors or memory: back off (10 ms doubling up to 1 s) rather than spin
+                unsigned delay = std::min(1000u, 10u << std::min(acceptFailures++, 7u));
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            }
+        }
+
+        for (size_t i = fds.size(); i-- > 1;)
+        {
+            if (!fds[i].revents)
+                continue;
+            ClientState state = serveClient(fds[i].fd, fds[i].revents, clients[i]);
+            if (state == ClientState::Open)
+            {
+                fds[i].events = pollEvents(clients[i]);
+                continue;
+            }
+            if (state == ClientState::Shutdown)
+                running = false;
+            close(fds[i].fd);
+            fds.erase(fds.begin() + i);
+            clients.erase(clients.begin() + i);
+        }
+    }
+
+    // Hand over the replies the sockets take right away; nobody waits for the rest
+    for (size_t i = 1; i < fds.size(); ++i)
+    {
+        sendSome(fds[i].fd, clients[i].output);
+        close(fds[i].fd);
+    }
+    close(listenFd);
+    unlink(socketPath.c_str());
+    return true;
+}
+
+
+QueryServer::ClientState QueryServer::serveClient(int fd, short revents, Client &client)
+{
+    if (revents & POLLIN)
+    {
+        char chunk[4096];
+        ssize_t len = read(fd, chunk, sizeof(chunk));
+        if (len == 0 || (len < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+            return ClientState::Closed;
+        if (len > 0)
+            client.input.append(chunk, len);
+    }
+    else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+        return ClientState::Closed;
+
+    // Answer and send until the socket is full or no complete request is left
+    while (true)
+    {
+        ClientState state = answerRequests(client);
+        if (state != ClientState::Open)
+            return state;
+        if (!sendSome(fd, client.output))
+            return ClientState::Closed;
+        if (!client.output.empty() || client.quitting || client.input.find('\n') == std::string::npos)
+            break;
+    }
+    if (client.quitting && client.output.empty())
+        return ClientState::Closed;
+    // No request is this long: the client is not speaking the protocol
+    return client.input.size() > MaxRequestSize && client.input.find('\n') == std::string::npos ?
+           ClientState::Closed : ClientState::Open;
+}
+
+
+QueryServer::ClientState QueryServer::answerRequests(Client &client)
+{
+    size_t eol;
+    while (!client.quitting && client.output.size() < MaxPendingOutput &&
+           (eol = client.input.find('\n')) != std::string::npos)
+    {
+        std::string request = client.input.substr(0, eol);
+        client.input.erase(0, eol + 1);
+        if (!request.empty() && request.back() == '\r')
+            request.pop_back();
+
+        if (request == "quit")
+            client.quitting = true;
+        else if (request == "shutdown")
+            return ClientState::Shutdown;
+        else
+            client.output += answer(request) + "\n";
+    }
+    return ClientState::Open;
+}
+
+
+short QueryServer::pollEvents(const Client &client)
+{
+    // A client that leaves its replies unread is not read from either, which bounds what it can make us buffer
+    short events = client.output.empty() ? 0 : POLLOUT;
+    if (!client.quitting && client.output.size() < MaxPendingOutput)
+        events |= POLLIN;
+    return events;
+}
+
+
+std::string QueryServer::answer(const std::string &request)
+{
+    std::istringstream in(request);
+    std::string cmd;
+    in >> cmd;
+
+    auto consg = andersen.getConstraintGraph();
+    if (cmd == "resolve")
+    {
+        std::string reply;
+        for (const auto &entry : consg->getIndirectCallsites())
+            reply += std::to_string(entry.first->getId()) + ": " + resolve(entry.second) + "; ";
+        return reply;
+    }
+    if (cmd == "callees")
+    {
+        unsigned id;
+        if (!(in >> id))
+            return "error: usage 'callees <callsite>'";
+        for (const auto &entry : consg->getIndirectCallsites())
+            if (entry.first->getId() == id)
+                return resolve(entry.second);
+        return "error: " + std::to_string(id) + " is not an indirect call site";
+    }
+    if (cmd == "pts")
+    {
+        unsigned id;
+        if (!(in >> id))
+            return "error: usage 'pts <node>'";
+        std::string reply = "{";
+        auto pointees = index.pointsTo(id);
+        for (auto pointee = pointees.first; pointee != pointees.second; ++pointee)
+            reply += std::to_string(*pointee) + ", ";
+        return reply + "}";
+    }
+    if (cmd == "alias")
+    {
+        unsigned p, q;
+        if (!(in >> p >> q))
+            return "error: usage 'alias <node> <node>'";
+        return index.mayAlias(p, q) ? "may" : "no";
+    }
+    if (cmd == "path")
+    {
+        std::string from, to;
+        if (!(in >> from >> to))
+            return "error: usage 'path <caller> <callee>'";
+        return findPath(from, to);
+    }
+    return "error: unknown request '" + cmd + "'";
+}
+
+
+std::string QueryServer::resolve(unsigned funPtr)
+{
+    auto consg = andersen.getConstraintGraph();
+    std::string reply;
+    for (auto target : andersen.getPts(funPtr))
+    {
+        if (consg->isFunction(target))
+            reply += consg->getFunction(target)->getName() + " ";
+    }
+    return reply;
+}
+
+
+std::string QueryServer::findPath(const std::string &from, const std::string &to)
+{
+    // BFS over the (resolved) call graph
+    std::map<SVF::NodeID, SVF::NodeID> parent;
+    std::deque<SVF::NodeID> queue;
+    for (auto &it : *cg)
+    {
+        if (it.second->getFunction()->getName() == from)
+        {
+            parent[it.first] = it.first;
+            queue.push_back(it.first);
+        }
+    }
+
+    while (!queue.empty())
+    {
+        SVF::NodeID cur = queue.front();
+        queue.pop_front();
+        auto node = cg->getGNode(cur);
+        if (node->getFunction()->getName() == to)
+        {
+            std::vector<std::string> chain;
+            for (SVF::NodeID n = cur;; n = parent[n])
+            {
+                chain.push_back(cg->getGNode(n)->getFunction()->getName());
+                if (parent[n] == n)
+                    break;
+            }
+            std::string reply;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+                reply += (it == chain.rbegin() ? "" : " -> ") + *it;
+            return reply;
+        }
+        for (auto edge : node->getOutEdges())
+        {
+            if (parent.emplace(edge->getDstID(), cur).second)
+                queue.push_back(edge->getDstID());
+        }
+    }
+    return "no path";
+}
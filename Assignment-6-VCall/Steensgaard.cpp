@@ -0,0 +1,176 @@
+/**
+ * Steensgaard.cpp
+ * @author kisslune
+ */
+
+#include "A6Header.h"
+
+Steensgaard::Steensgaard(SVF::ConstraintGraph *consg) :
+        consg(consg)
+{
+    unsigned maxId = 0;
+    for (auto &item : *consg)
+        maxId = std::max(maxId, (unsigned) item.first);
+    for (unsigned id = 0; id <= maxId; ++id)
+        newClass();
+}
+
+
+unsigned Steensgaard::newClass()
+{
+    unsigned id = parent.size();
+    parent.push_back(id);
+    rank.push_back(0);
+    pointsTo.push_back(NoClass);
+    return id;
+}
+
+
+unsigned Steensgaard::find(unsigned id)
+{
+    // Nodes created after construction (e.g. field objects) are singleton classes
+    if (id >= parent.size())
+        return id;
+    unsigned root = id;
+    while (parent[root] != root)
+        root = parent[root];
+    while (parent[id] != root)
+    {
+        unsigned next = parent[id];
+        parent[id] = root;
+        id = next;
+    }
+    return root;
+}
+
+
+void Steensgaard::join(unsigned a, unsigned b)
+{
+    // Unifying two classes unifies their pointees as well
+    std::vector<std::pair<unsigned, unsigned>> pending = {{a, b}};
+    while (!pending.empty())
+    {
+        unsigned ra = find(pending.back().first);
+        unsigned rb = find(pending.back().second);
+        pending.pop_back();
+        if (ra == rb || ra >= parent.size() || rb >= parent.size())
+            continue;
+
+        if (rank[ra] < rank[rb])
+            std::swap(ra, rb);
+        parent[rb] = ra;
+        if (rank[ra] == rank[rb])
+            ++rank[ra];
+
+        if (pointsTo[ra] == NoClass)
+            pointsTo[ra] = pointsTo[rb];
+        else if (pointsTo[rb] != NoClass)
+            pending.emplace_back(pointsTo[ra], pointsTo[rb]);
+    }
+}
+
+
+unsigned Steensgaard::pointee(unsigned id)
+{
+    unsigned rep = find(id);
+    if (rep >= parent.size())
+        return NoClass;
+    if (pointsTo[rep] == NoClass)
+    {
+        unsigned cls = newClass();
+        pointsTo[rep] = cls;
+    }
+    return find(pointsTo[rep]);
+}
+
+
+void Steensgaard::solve()
+{
+    for (auto &item : *consg)
+    {
+        auto node = item.second;
+        for (auto edge : node->getAddrInEdges())
+        {
+            // p = &o
+            objects.insert(edge->getSrcID());
+            join(pointee(edge->getDstID()), edge->getSrcID());
+        }
+        // q = p and q = &p->f (fields are not distinguished)
+        for (auto edge : node->getCopyOutEdges())
+            join(pointee(edge->getSrcID()), pointee(edge->getDstID()));
+        for (auto edge : node->getGepOutEdges())
+            join(pointee(edge->getSrcID()), pointee(edge->getDstID()));
+        // q = *p
+        for (auto edge : node->getLoadOutEdges())
+            join(pointee(pointee(edge->getSrcID())), pointee(edge->getDstID()));
+        // *p = q
+        for (auto edge : node->getStoreInEdges())
+            join(pointee(pointee(edge->getDstID())), pointee(edge->getSrcID()));
+    }
+}
+
+
+std::set<unsigned> Steensgaard::getPts(unsigned id)
+{
+    std::set<unsigned> result;
+    unsigned rep = find(id);
+    if (rep >= parent.size() || pointsTo[rep] == NoClass)
+        return result;
+    if (classObjects.empty())
+    {
+        for (auto obj : objects)
+            classObjects[find(obj)].insert(obj);
+    }
+    auto it = classObjects.find(find(pointsTo[rep]));
+    return it == classObjects.end() ? result : it->second;
+}
+
+
+std::unordered_set<unsigned> Steensgaard::functionRelevantNodes()
+{
+    // Classes holding a function object
+    std::unordered_set<unsigned> funClasses;
+    for (auto obj : objects)
+    {
+        if (consg->isFunction(obj))
+            funClasses.insert(find(obj));
+    }
+
+    // Memoized walk along the pointee chain of every class (chains may end in a cycle)
+    enum State : unsigned char { Unknown, Visiting, Yes, No };
+    std::vector<State> state(parent.size(), Unknown);
+    auto reachesFunction = [&](unsigned cls) {
+        std::vector<unsigned> chain;
+        bool found = false;
+        for (unsigned cur = find(cls);; cur = find(pointsTo[cur]))
+        {
+            if (state[cur] == Yes || state[cur] == No)
+            {
+                found = state[cur] == Yes;
+                break;
+            }
+            if (state[cur] == Visiting)
+                break;
+            state[cur] = Visiting;
+            chain.push_back(cur);
+            if (pointsTo[cur] == NoClass)
+                break;
+            if (funClasses.count(find(pointsTo[cur])))
+            {
+                found = true;
+                break;
+            }
+        }
+        for (auto c : chain)
+            state[c] = found ? Yes : No;
+        return found;
+    };
+
+    std::unordered_set<unsigned> relevant;
+    for (auto &item : *consg)
+    {
+        if (reachesFunction(item.first))
+            relevant.insert(item.first);
+    }
+    return relevant;
+}
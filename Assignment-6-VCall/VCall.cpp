@@ -4,16 +4,126 @@
  */
 
 #include "A6Header.h"
+#include "BatchDriver.h"
 
 using namespace llvm;
 using namespace std;
 
-int main(int argc, char** argv)
+static const SVF::Option<std::string> ServerSocket("server",
+        "After solving, keep the results resident and answer queries on this Unix socket", "");
+static const SVF::Option<std::string> Manifest("manifest",
+        "Batch mode: analyze every program listed in this file (one per line)", "");
+static const SVF::Option<SVF::u32_t> BatchJobs("batch-jobs", "Number of programs analyzed concurrently in batch mode", 2);
+static const SVF::Option<SVF::u32_t> FieldLimit("field-limit",
+        "Max field objects per object before it is collapsed to field-insensitive (0: unlimited)", 0);
+static const SVF::Option<bool> DemandDriven("demand",
+        "Only solve the points-to sets of indirect call-site pointers, on demand", false);
+static const SVF::Option<bool> SliceCallsites("slice",
+        "Solve only the backward slice of the indirect call-site pointers", true);
+static const SVF::Option<bool> SteensOnly("steens",
+        "Resolve indirect calls with a unification-based (Steensgaard) analysis only", false);
+static const SVF::Option<bool> SteensPrune("steens-prune",
+        "Use a Steensgaard pre-pass to skip nodes that cannot lead to a function before solving", false);
+static const SVF::Option<bool> Renumber("renumber",
+        "Number nodes and objects in copy-graph BFS order before solving, so points-to bit vectors span fewer words",
+        false);
+static const SVF::Option<bool> MergeObjects("merge-objects",
+        "Solve location-equivalent objects (address taken by the same pointers) as one object", false);
+static const SVF::Option<SVF::u32_t> DemandBudget("demand-budget",
+        "Max constraint nodes one demand query may visit before falling back to a whole-program solve (0: unlimited)",
+        100000);
+static const SVF::Option<bool> CHAPrepass("cha",
+        "Resolve virtual calls with few class-hierarchy targets before pointer analysis", false);
+static const SVF::Option<SVF::u32_t> CHAMaxTargets("cha-max-targets",
+        "Max class-hierarchy targets for a virtual call to be resolved by -cha (0: unlimited)", 4);
+static const SVF::Option<std::string> PromotionHints("promotion-hints",
+        "Write the indirect calls with few resolved targets to this file, for guarded direct-call promotion", "");
+static const SVF::Option<SVF::u32_t> PromoteMaxTargets("promote-max-targets",
+        "Max resolved targets for an indirect call to be listed in the promotion hints", 2);
+static const SVF::Option<std::string> ReachRoots("reach-roots",
+        "Comma-separated functions the program starts from, for -unreachable-funcs and -prune-module", "main");
+static const SVF::Option<bool> ReachClosedWorld("reach-closed-world",
+        "Start only from -reach-roots: also prune functions with external linkage or whose address is taken "
+        "(unsound if code outside the module calls them)", false);
+static const SVF::Option<std::string> UnreachableFuncs("unreachable-funcs",
+        "Write the defined functions not reachable from -reach-roots in the resolved call graph to this file", "");
+static const SVF::Option<std::string> PruneModule("prune-module",
+        "Write the main module without the functions unreachable from -reach-roots to this bitcode file", "");
+static const SVF::Option<std::string> QueryIndex("query-index",
+        "Write the solved points-to sets to this file as a memory-mappable query index (see PointsToIndex.h)", "");
+static const SVF::Option<std::string> Checkpoint("checkpoint",
+        "Save the solver state to this file periodically and at the deadline (default: <module>.ckpt)", "");
+static const SVF::Option<SVF::u32_t> CheckpointInterval("checkpoint-interval",
+        "Seconds between checkpoints while solving (0: only at the deadline)", 600);
+static const SVF::Option<SVF::u32_t> Deadline("deadline",
+        "Stop solving after this many seconds, writing a checkpoint to resume from (0: no deadline)", 0);
+static const SVF::Option<bool> ArenaStats("arena-stats",
+        "Print the statistics of the solver's memory arena after solving", false);
+static const SVF::Option<bool> Resume("resume", "Continue solving from the checkpoint file", false);
+static const SVF::Option<SVF::u32_t> FieldBudget("field-budget",
+        "Max field objects in total; objects creating more are collapsed (0: unlimited)", 0);
+
+/**
+ * Write one line per indirect call site with 1..maxTargets resolved callees:
+ *   <caller> <TAB> <call site ICFG ID> <TAB> <source location> <TAB> <callee>[,<callee>...]
+ * A compiler pass can turn each into "if (fp == callee) callee(...); else fp(...);" chains.
+ */
+static bool writePromotionHints(SVF::CallGraph* cg, const std::string& path, unsigned maxTargets)
 {
-    auto moduleNameVec =
-            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
-                                     "[options] <input-bitcode...>");
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "error opening " << path << std::endl;
+        return false;
+    }
 
+    std::map<unsigned, std::string> lines;     // by call site, for a stable order
+    for (const auto& entry : cg->getIndCallMap()) {
+        auto* callNode = entry.first;
+        if (entry.second.empty() || entry.second.size() > maxTargets) continue;
+
+        std::vector<std::string> callees;
+        for (auto* callee : entry.second)
+            callees.push_back(callee->getName());
+        std::sort(callees.begin(), callees.end());
+
+        std::string line = callNode->getCaller()->getName() + "\t" + std::to_string(callNode->getId()) + "\t" +
+                callNode->getSourceLoc() + "\t";
+        for (size_t i = 0; i < callees.size(); ++i)
+            line += (i ? "," : "") + callees[i];
+        lines[callNode->getId()] = line;
+    }
+    for (const auto& line : lines)
+        out << line.second << "\n";
+    return (bool) out;
+}
+
+/// Find the functions unreachable from the roots and write the list and/or the pruned module
+static void reportUnreachable(SVF::CallGraph* cg)
+{
+    std::vector<std::string> roots;
+    std::istringstream names(ReachRoots());
+    for (std::string name; std::getline(names, name, ',');)
+        roots.push_back(name);
+
+    CallGraphReach reach(cg);
+    size_t numReachable = reach.computeReachable(roots, !ReachClosedWorld());
+    std::cout << numReachable << " of " << reach.numFunctions() << " functions reachable ("
+              << reach.numSCCs() << " call-graph SCCs)" << std::endl;
+
+    if (!UnreachableFuncs().empty()) {
+        std::ofstream out(UnreachableFuncs());
+        for (auto* func : reach.getUnreachable())
+            out << func->getName() << "\n";
+        if (!out)
+            std::cout << "error writing " << UnreachableFuncs() << std::endl;
+    }
+    if (!PruneModule().empty() && !reach.writePrunedModule(PruneModule()))
+        std::cout << "error writing " << PruneModule() << std::endl;
+}
+
+/// Build, solve and dump one program
+static int analyzeModule(const std::vector<std::string>& moduleNameVec)
+{
     SVF::LLVMModuleSet::buildSVFModule(moduleNameVec);
 
     SVF::SVFIRBuilder builder;
@@ -22,70 +132,157 @@ int main(int argc, char** argv)
     consg->dump();
 
     Andersen andersen(consg);
+    andersen.setFieldLimits(FieldLimit(), FieldBudget());
     auto cg = pag->getCallGraph();
 
-    // TODO: complete the following two methods
-    andersen.runPointerAnalysis();
+    if (MergeObjects())
+        andersen.mergeEquivalentObjects();
+    if (Renumber())
+        andersen.renumber();
+
+    // Only call sites the class hierarchy does not settle need points-to sets
+    if (CHAPrepass())
+        andersen.resolveVirtualCalls(cg, CHAMaxTargets());
+    std::vector<unsigned> funPtrs;
+    for (const auto& entry : consg->getIndirectCallsites()) {
+        if (!andersen.isPreResolved(entry.first))
+            funPtrs.push_back(entry.second);
+    }
+
+    // Query serving and the query index need every points-to set, not just the call-site pointers': the partial
+    // modes (-steens, -demand, -slice, -steens-prune) are turned off for them
+    bool wholeProgram = !ServerSocket().empty() || !QueryIndex().empty();
+    if (wholeProgram && (SteensOnly() || DemandDriven() || SteensPrune()))
+        std::cout << "-server/-query-index need the whole program solved; ignoring -steens, -demand and -steens-prune"
+                  << std::endl;
+    if (SteensOnly() && !wholeProgram) {
+        // Call-site pointers take the unification-based result as is
+        Steensgaard steens(consg);
+        steens.solve();
+        for (auto funPtr : funPtrs)
+            andersen.setPts(funPtr, steens.getPts(funPtr));
+    }
+    else if (DemandDriven() && !wholeProgram) {
+        if (!andersen.solveOnDemand(funPtrs, DemandBudget()))
+            std::cout << "demand budget exceeded, solved the whole program instead" << std::endl;
+    }
+    else {
+        if (SliceCallsites() && !wholeProgram)
+            andersen.sliceFrom(funPtrs);
+        if (SteensPrune() && !wholeProgram) {
+            Steensgaard steens(consg);
+            steens.solve();
+            andersen.restrictTo(steens.functionRelevantNodes());
+        }
+
+        bool checkpointing = !Checkpoint().empty() || Deadline() || Resume();
+        std::string checkpointPath = Checkpoint().empty() ? pag->getModuleIdentifier() + ".ckpt" : Checkpoint();
+        if (checkpointing)
+            andersen.setCheckpointing(checkpointPath, CheckpointInterval(), Deadline());
+        if (!Resume() || !andersen.resume(checkpointPath)) {
+            if (Resume())
+                std::cout << "no usable checkpoint in " << checkpointPath << ", solving from scratch" << std::endl;
+            andersen.runPointerAnalysis();
+        }
+        if (andersen.stoppedAtDeadline()) {
+            // Exit status 75 (EX_TEMPFAIL): not done yet, rerun with -resume
+            std::cout << "deadline reached, state saved to " << checkpointPath << std::endl;
+            SVF::LLVMModuleSet::releaseLLVMModuleSet();
+            return 75;
+        }
+    }
     andersen.updateCallGraph(cg);
+    if (ArenaStats())
+        andersen.reportMemory(std::cout);
+    int rc = 0;
+    if (!QueryIndex().empty() && !PointsToIndex::write(andersen.getAllPts(), QueryIndex()))
+    {
+        std::cout << "error writing " << QueryIndex() << std::endl;
+        rc = 1;
+    }
 
     cg->dump();
+    if (!PromotionHints().empty())
+        writePromotionHints(cg, PromotionHints(), PromoteMaxTargets());
+
+    if (!ServerSocket().empty())
+    {
+        QueryServer server(andersen, cg);
+        server.serve(ServerSocket());
+    }
+
+    // After serving: pruning edits the module the analysis was built from
+    if (!UnreachableFuncs().empty() || !PruneModule().empty())
+        reportUnreachable(cg);
+
     SVF::LLVMModuleSet::releaseLLVMModuleSet();
-    return 0;
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    auto moduleNameVec =
+            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
+                                     "[options] <input-bitcode...>");
+
+    if (!Manifest().empty())
+        return runBatch(Manifest(), BatchJobs(), analyzeModule) == 0 ? 0 : 1;
+    return analyzeModule(moduleNameVec);
 }
 
 
 void Andersen::runPointerAnalysis()
 {
-    // TODO: complete this method. Point-to set and worklist are defined in A5Header.h
-    //  The implementation of constraint graph is provided in the SVF library
-    
-    WorkList<unsigned> wList;
-
-    // Helper lambda to check existence before adding a Copy edge (avoids graph explosion)
-    auto tryAddCopyEdge = [&](unsigned srcId, unsigned dstId) -> bool {
-        auto* sNode = consg->getConstraintNode(srcId);
-        if (!sNode) return false;
-
-        // Scan existing edges to avoid duplicates
-        for (auto* e : sNode->getCopyOutEdges()) {
-            if (e->getDstID() == dstId) return false;
-        }
-
-        consg->addCopyCGEdge(srcId, dstId);
-        return true;
-    };
+    workList.clear();
+    fieldObjCache.clear();
+    fieldObjCache.reserve(consg->getTotalNodeNum());
+    initialNodeNum = consg->getTotalNodeNum();
 
     // Phase 1: Initialize points-to sets with Address-of constraints (p = &a)
     for (auto const& item : *consg) {
         auto nodeId = item.first;
         auto* node = item.second;
+        if (!inScope(nodeId)) continue;
 
         for (auto* edge : node->getAddrInEdges()) {
             if (auto* addr = SVF::SVFUtil::dyn_cast<SVF::AddrCGEdge>(edge)) {
-                // If insertion is successful (element was new), add to worklist
-                if (pts[nodeId].insert(addr->getSrcID()).second) {
-                    wList.push(nodeId);
-                }
+                pts.insert(nodeId, locRep(addr->getSrcID()));
             }
         }
     }
+    // Every non-empty set has to be propagated, including sets seeded before solving
+    for (auto nodeId : pts.getNodes())
+        workList.push(nodeId);
 
     // Phase 2: Worklist algorithm for transitive closure
-    while (!wList.empty()) {
-        auto topId = wList.pop();
+    solveWorkList();
+}
+
+
+void Andersen::solveWorkList()
+{
+    unsigned steps = 0;
+    while (!workList.empty() && !budgetExceeded && !deadlineHit) {
+        // Look at the clock every few thousand steps, between two steps so that a checkpoint is consistent
+        if ((++steps & 4095) == 0 && checkClock()) break;
+
+        auto topId = workList.pop();
         auto* topNode = consg->getConstraintNode(topId);
-        const auto& topPts = pts[topId]; // Current points-to set
+        auto topSet = pts.getID(topId);
+        const auto& topPts = pts.getSet(topSet); // Current points-to set (interned, so it stays valid)
 
         // 2a. Handle Complex Constraints (Load/Store)
         // Iterate over all objects 'o' that 'topId' points to
-        for (auto o : topPts) {
-            
+        for (auto oIdx : topPts) {
+            auto o = pts.toObj(oIdx);
+
             // Store: *topId = src  =>  Add Copy Edge: src -> o
             for (auto* edge : topNode->getStoreInEdges()) {
                 if (auto* store = SVF::SVFUtil::dyn_cast<SVF::StoreCGEdge>(edge)) {
-                    if (tryAddCopyEdge(store->getSrcID(), o)) {
+                    requireObj(o);
+                    if (addCopyEdge(store->getSrcID(), o)) {
                         // If edge is new, process src to propagate its values
-                        wList.push(store->getSrcID());
+                        workList.push(store->getSrcID());
                     }
                 }
             }
@@ -93,9 +290,10 @@ void Andersen::runPointerAnalysis()
             // Load: dst = *topId  =>  Add Copy Edge: o -> dst
             for (auto* edge : topNode->getLoadOutEdges()) {
                 if (auto* load = SVF::SVFUtil::dyn_cast<SVF::LoadCGEdge>(edge)) {
-                    if (tryAddCopyEdge(o, load->getDstID())) {
+                    requireObj(o);
+                    if (addCopyEdge(o, load->getDstID())) {
                         // If edge is new, process o to propagate its values
-                        wList.push(o);
+                        workList.push(o);
                     }
                 }
             }
@@ -105,15 +303,10 @@ void Andersen::runPointerAnalysis()
         for (auto* edge : topNode->getCopyOutEdges()) {
             if (auto* copy = SVF::SVFUtil::dyn_cast<SVF::CopyCGEdge>(edge)) {
                 auto dst = copy->getDstID();
-                auto& dstSet = pts[dst];
-                bool isChanged = false;
+                if (!inScope(dst)) continue;
 
                 // Propagate everything topId points to -> dst
-                for (auto val : topPts) {
-                    if (dstSet.insert(val).second) isChanged = true;
-                }
-
-                if (isChanged) wList.push(dst);
+                if (pts.unionWith(dst, topSet)) workList.push(dst);
             }
         }
 
@@ -121,16 +314,23 @@ void Andersen::runPointerAnalysis()
         for (auto* edge : topNode->getGepOutEdges()) {
             if (auto* gep = SVF::SVFUtil::dyn_cast<SVF::GepCGEdge>(edge)) {
                 auto dst = gep->getDstID();
-                auto& dstSet = pts[dst];
-                bool isChanged = false;
+                if (!inScope(dst)) continue;
 
                 // Calculate offset for each object topId points to
-                for (auto val : topPts) {
-                    auto offsetObj = consg->getGepObjVar(val, gep);
-                    if (dstSet.insert(offsetObj).second) isChanged = true;
+                std::vector<unsigned> fieldObjs;
+                for (auto valIdx : topPts) {
+                    auto val = pts.toObj(valIdx);
+                    // A merged object stands for its whole class, and every member has fields of its own
+                    auto members = repMembers.find(val);
+                    if (members == repMembers.end()) {
+                        fieldObjs.push_back(getFieldObj(val, gep));
+                        continue;
+                    }
+                    for (auto member : members->second)
+                        fieldObjs.push_back(getFieldObj(member, gep));
                 }
 
-                if (isChanged) wList.push(dst);
+                if (pts.unionWithObjs(dst, fieldObjs)) workList.push(dst);
             }
         }
     }
@@ -139,19 +339,17 @@ void Andersen::runPointerAnalysis()
 
 void Andersen::updateCallGraph(SVF::CallGraph* cg)
 {
-    // TODO: complete this method.
-    //  The implementation of call graph is provided in the SVF library
-    
     // Iterate over all indirect call sites (e.g., function pointers)
     for (const auto& entry : consg->getIndirectCallsites()) {
         auto* callNode = entry.first;
         auto funcPtrId = entry.second;
+        if (isPreResolved(callNode)) continue;
 
         // If the pointer has no points-to targets, skip
-        if (pts.find(funcPtrId) == pts.end()) continue;
+        auto possibleTargets = getPts(funcPtrId);
+        if (possibleTargets.empty()) continue;
 
         auto* callerFunc = callNode->getCaller();
-        const auto& possibleTargets = pts[funcPtrId];
 
         for (auto targetId : possibleTargets) {
             // Verify the target is actually a function before adding edge
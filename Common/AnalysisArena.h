@@ -0,0 +1,99 @@
+/**
+ * AnalysisArena.h
+ *
+ * Per-analysis memory for the solvers' node-based containers. An arena offers two resources: a monotonic buffer
+ * for append-only data (logs that only grow) and size-class pools for containers that also free (adjacency
+ * sets, worklist dedup sets, points-to sets). Both take large chunks from the global allocator and give all of
+ * them back at once when the arena is destroyed, instead of one malloc/free per node. Containers using an arena
+ * must be destroyed before it, and an arena is single-threaded.
+ *
+ * Every resource counts its traffic; report() prints the requests served and the memory taken from the system.
+ */
+
+#ifndef ANSWERS_ANALYSISARENA_H
+#define ANSWERS_ANALYSISARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+
+/// A pass-through resource that counts what goes through it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource *upstream) :
+            upstream(upstream)
+    {}
+
+    size_t requests = 0;    ///< allocations served
+    size_t bytes = 0;       ///< bytes allocated in total
+    size_t liveBytes = 0;   ///< bytes allocated and not yet deallocated
+    size_t peakBytes = 0;   ///< maximum of liveBytes
+
+protected:
+    void *do_allocate(size_t size, size_t alignment) override
+    {
+        void *p = upstream->allocate(size, alignment);
+        ++requests;
+        bytes += size;
+        liveBytes += size;
+        if (liveBytes > peakBytes)
+            peakBytes = liveBytes;
+        return p;
+    }
+
+    void do_deallocate(void *p, size_t size, size_t alignment) override
+    {
+        upstream->deallocate(p, size, alignment);
+        liveBytes -= size;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    { return this == &other; }
+
+    std::pmr::memory_resource *upstream;
+};
+
+
+class AnalysisArena
+{
+public:
+    AnalysisArena() :
+            system(std::pmr::new_delete_resource()), buffer(&system), pools(&system), bufferFront(&buffer),
+            poolFront(&pools)
+    {}
+
+    AnalysisArena(const AnalysisArena &) = delete;
+    AnalysisArena &operator=(const AnalysisArena &) = delete;
+
+    /// For append-only data: deallocation is a no-op and memory is reclaimed with the arena
+    inline std::pmr::memory_resource *monotonic()
+    { return &bufferFront; }
+
+    /// For containers that free: freed blocks are reused by later requests of the same size class
+    inline std::pmr::memory_resource *pool()
+    { return &poolFront; }
+
+    /// Print the allocator statistics, one line prefixed with name
+    void report(std::ostream &out, const std::string &name) const
+    {
+        out << name << " arena: " << poolFront.requests << " pool requests (" << kb(poolFront.bytes)
+            << " KB, peak live " << kb(poolFront.peakBytes) << " KB), " << bufferFront.requests
+            << " monotonic requests (" << kb(bufferFront.bytes) << " KB); " << system.requests
+            << " chunks from the system, peak " << kb(system.peakBytes) << " KB" << std::endl;
+    }
+
+protected:
+    static size_t kb(size_t bytes)
+    { return (bytes + 1023) / 1024; }
+
+    // Declaration order is construction order: the fronts wrap the resources, which draw from system
+    CountingResource system;                        ///< chunks taken from the global allocator
+    std::pmr::monotonic_buffer_resource buffer;
+    std::pmr::unsynchronized_pool_resource pools;
+    CountingResource bufferFront;                   ///< requests served by the monotonic buffer
+    CountingResource poolFront;                     ///< requests served by the pools
+};
+
+#endif //ANSWERS_ANALYSISARENA_H
@@ -0,0 +1,143 @@
+/**
+ * BatchDriver.h
+ *
+ * Batch mode shared by the analysis drivers. A manifest lists one program per line (its bitcode files separated
+ * by whitespace; blank lines and lines starting with '#' are skipped). Every program is analyzed in a forked
+ * worker, and up to 'jobs' workers run at once, so the IR of program N+1 is built while program N is being
+ * solved. Each worker writes its usual per-module result files.
+ *
+ * Workers are processes rather than threads because SVF keeps the module set and the SVFIR in process-wide
+ * singletons; a worker's memory is returned to the system when it exits, which keeps the batch bounded by
+ * 'jobs' programs.
+ */
+
+#ifndef ANSWERS_BATCHDRIVER_H
+#define ANSWERS_BATCHDRIVER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using BatchEntry = std::vector<std::string>;
+
+/// Read the programs listed in a manifest file
+inline std::vector<BatchEntry> readManifest(const std::string &path)
+{
+    std::vector<BatchEntry> entries;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream words(line);
+        BatchEntry entry;
+        std::string word;
+        while (words >> word && word[0] != '#')
+            entry.push_back(word);
+        if (!entry.empty())
+            entries.push_back(entry);
+    }
+    return entries;
+}
+
+/**
+ * Run analyze on every program of the manifest, at most jobs at a time
+ * @return the number of programs whose analysis failed
+ */
+inline unsigned runBatch(const std::string &manifest, unsigned jobs,
+                         const std::function<int(const BatchEntry &)> &analyze)
+{
+    auto entries = readManifest(manifest);
+    if (entries.empty())
+    {
+        std::cout << "no modules in manifest " + manifest + "\n";
+        return 0;
+    }
+    jobs = std::max(jobs, 1u);
+    // Workers must stay waitable: with SIGCHLD ignored the kernel reaps them and their exit status is lost
+    auto oldHandler = signal(SIGCHLD, SIG_DFL);
+
+    struct Running
+    {
+        size_t entry;
+        std::chrono::steady_clock::time_point start;
+    };
+    std::map<pid_t, Running> running;
+    unsigned failures = 0;
+
+    auto finish = [&](std::map<pid_t, Running>::iterator it, bool ok, const std::string &note) {
+        failures += !ok;
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->second.start).count();
+        std::cout << (ok ? "[done]   " : "[failed] ") << entries[it->second.entry][0] << " (" << secs << "s"
+                  << note << ")" << std::endl;
+        running.erase(it);
+    };
+
+    // Wait for one worker to exit and free its slot
+    auto reap = [&]() {
+        int status = 0;
+        pid_t pid;
+        do
+            pid = wait(&status);
+        while (pid < 0 && errno == EINTR);
+        if (pid >= 0)
+        {
+            auto it = running.find(pid);
+            if (it != running.end())
+                finish(it, WIFEXITED(status) && WEXITSTATUS(status) == 0, "");
+            return;
+        }
+
+        // wait() found no child to report, so one was reaped behind our back; ask for a tracked worker by pid,
+        // which blocks while it is still alive and keeps it counted against 'jobs'
+        auto it = running.begin();
+        do
+            pid = waitpid(it->first, &status, 0);
+        while (pid < 0 && errno == EINTR);
+        if (pid == it->first)
+            finish(it, WIFEXITED(status) && WEXITSTATUS(status) == 0, "");
+        else
+            finish(it, false, ", exit status lost");
+    };
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        while (running.size() >= jobs)
+            reap();
+
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            int rc = analyze(entries[i]);
+            std::cout.flush();
+            _exit(rc);
+        }
+        if (pid < 0)
+        {
+            std::cout << "[failed] " << entries[i][0] << " (cannot fork)" << std::endl;
+            ++failures;
+            continue;
+        }
+        running[pid] = {i, std::chrono::steady_clock::now()};
+    }
+    while (!running.empty())
+        reap();
+
+    signal(SIGCHLD, oldHandler);
+
+    std::cout << entries.size() - failures << "/" << entries.size() << " modules analyzed" << std::endl;
+    return failures;
+}
+
+#endif //ANSWERS_BATCHDRIVER_H
@@ -0,0 +1,281 @@
+/**
+ * PointsToIndex.h
+ *
+ * A read-only index over solved points-to sets, built by the solvers after solving and usable in memory or
+ * exported to a file that clients map read-only, so they can query without re-solving or parsing .res.txt.
+ * pointsTo is two array lookups; mayAlias intersects two bit vectors with the SetKernels.h kernels and is
+ * memoized per pair of distinct sets, so pointers that share a set share cache entries. The memo makes an
+ * index object single-threaded: give each thread its own (they can map the same file).
+ *
+ * Layout (little-endian; words are uint64_t, everything else uint32_t):
+ *   IndexHeader | words[numWords] | SetRecord[numSets] | nodeSets[numNodes] | objs[numObjs]
+ * Set 0 is the empty set. nodeSets maps a node ID to its set; objs holds the object IDs of every set, sorted;
+ * words holds every set as a bit vector over dense object indices.
+ */
+
+#ifndef ANSWERS_POINTSTOINDEX_H
+#define ANSWERS_POINTSTOINDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SetKernels.h"
+
+/// (pointer, objects it points to) pairs, the input of PointsToIndex
+using PointsToList = std::vector<std::pair<unsigned, std::vector<unsigned>>>;
+
+class PointsToIndex
+{
+public:
+    static constexpr const char *Magic = "PTSINDX";
+    static constexpr uint32_t Version = 1;
+
+    struct IndexHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t numNodes;
+        uint32_t numSets;
+        uint32_t numObjs;
+        uint32_t numWords;
+        uint32_t reserved;
+    };
+
+    struct SetRecord
+    {
+        uint32_t objBegin;
+        uint32_t objCount;
+        uint32_t wordBegin;
+        uint32_t wordCount;
+    };
+
+    PointsToIndex() = default;
+    PointsToIndex(const PointsToIndex &) = delete;
+    PointsToIndex &operator=(const PointsToIndex &) = delete;
+
+    ~PointsToIndex()
+    { close(); }
+
+    /// Build the index in memory
+    void load(const PointsToList &pts)
+    {
+        close();
+        image = build(pts);
+        attach(image.data(), image.size() * sizeof(uint64_t));
+    }
+
+    /// Map an index file; returns false if it is missing or malformed
+    bool open(const std::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(IndexHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            mapped = nullptr;
+            return false;
+        }
+        mappedSize = st.st_size;
+        if (!attach(mapped, mappedSize))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (mapped)
+            munmap(mapped, mappedSize);
+        mapped = nullptr;
+        mappedSize = 0;
+        image.clear();
+        header = nullptr;
+        memoKeys.assign(MemoSize, 0);
+    }
+
+    /// Write the index of pts to path
+    static bool write(const PointsToList &pts, const std::string &path)
+    {
+        auto words = build(pts);
+        std::ofstream out(path, std::ios::out | std::ios::binary);
+        out.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+        return (bool) out;
+    }
+
+    inline size_t numNodes() const
+    { return header->numNodes; }
+
+    /// Objects node points to, sorted, as a [begin, end) range
+    inline std::pair<const uint32_t *, const uint32_t *> pointsTo(unsigned node) const
+    {
+        const SetRecord &set = sets[setOf(node)];
+        return {objs + set.objBegin, objs + set.objBegin + set.objCount};
+    }
+
+    /// Whether p and q may point to a common object
+    inline bool mayAlias(unsigned p, unsigned q) const
+    {
+        uint32_t a = setOf(p), b = setOf(q);
+        if (a == 0 || b == 0)
+            return false;
+        if (a == b)
+            return true;
+        if (a > b)
+            std::swap(a, b);
+
+        // Direct-mapped memo: key is the set pair, its low bit holds the answer
+        uint64_t key = ((uint64_t) a << 32 | b) << 1;
+        uint64_t &slot = memoKeys[(key * 0x9E3779B97F4A7C15ULL) >> (64 - MemoBits)];
+        if ((slot & ~(uint64_t) 1) == key)
+            return slot & 1;
+        const SetRecord &x = sets[a], &y = sets[b];
+        bool alias = setKernels().intersects(words + x.wordBegin, words + y.wordBegin,
+                                             std::min(x.wordCount, y.wordCount));
+        slot = key | alias;
+        return alias;
+    }
+
+protected:
+    static constexpr unsigned MemoBits = 16;
+    static constexpr size_t MemoSize = size_t(1) << MemoBits;
+
+    inline uint32_t setOf(unsigned node) const
+    { return node < header->numNodes ? nodeSets[node] : 0; }
+
+    /// Serialize pts into the file layout, as 64-bit words so the image is aligned for the bit vectors
+    static std::vector<uint64_t> build(const PointsToList &pts)
+    {
+        // Dense object indices, in object ID order
+        std::vector<unsigned> allObjs;
+        unsigned numNodes = 0;
+        for (auto &entry : pts)
+        {
+            allObjs.insert(allObjs.end(), entry.second.begin(), entry.second.end());
+            numNodes = std::max(numNodes, entry.first + 1);
+        }
+        std::sort(allObjs.begin(), allObjs.end());
+        allObjs.erase(std::unique(allObjs.begin(), allObjs.end()), allObjs.end());
+
+        std::map<std::vector<unsigned>, uint32_t> setIds;
+        std::vector<const std::vector<unsigned> *> setObjs;
+        std::vector<uint32_t> nodeSets(numNodes, 0);
+        static const std::vector<unsigned> empty;
+        setIds[empty] = 0;
+        setObjs.push_back(&empty);
+        std::vector<std::vector<unsigned>> sorted;
+        sorted.reserve(pts.size());
+        for (auto &entry : pts)
+        {
+            sorted.push_back(entry.second);
+            auto &objs = sorted.back();
+            std::sort(objs.begin(), objs.end());
+            objs.erase(std::unique(objs.begin(), objs.end()), objs.end());
+            auto it = setIds.emplace(objs, setObjs.size());
+            if (it.second)
+                setObjs.push_back(&it.first->first);
+            nodeSets[entry.first] = it.first->second;
+        }
+
+        std::vector<SetRecord> records;
+        std::vector<uint32_t> objList;
+        std::vector<uint64_t> wordList;
+        for (auto objs : setObjs)
+        {
+            WordSet bits;
+            for (auto obj : *objs)
+                bits.set(std::lower_bound(allObjs.begin(), allObjs.end(), obj) - allObjs.begin());
+            records.push_back({(uint32_t) objList.size(), (uint32_t) objs->size(), (uint32_t) wordList.size(),
+                               (uint32_t) bits.getWords().size()});
+            objList.insert(objList.end(), objs->begin(), objs->end());
+            wordList.insert(wordList.end(), bits.getWords().begin(), bits.getWords().end());
+        }
+
+        IndexHeader hdr{};
+        std::memcpy(hdr.magic, Magic, sizeof(hdr.magic));
+        hdr.version = Version;
+        hdr.numNodes = numNodes;
+        hdr.numSets = records.size();
+        hdr.numObjs = objList.size();
+        hdr.numWords = wordList.size();
+
+        std::string bytes(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+        bytes.append(reinterpret_cast<const char *>(wordList.data()), wordList.size() * sizeof(uint64_t));
+        bytes.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SetRecord));
+        bytes.append(reinterpret_cast<const char *>(nodeSets.data()), nodeSets.size() * sizeof(uint32_t));
+        bytes.append(reinterpret_cast<const char *>(objList.data()), objList.size() * sizeof(uint32_t));
+        std::vector<uint64_t> image((bytes.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        std::memcpy(image.data(), bytes.data(), bytes.size());
+        return image;
+    }
+
+    /// Point the views at an image; returns false if it is malformed
+    bool attach(const void *base, size_t size)
+    {
+        auto bytes = static_cast<const char *>(base);
+        header = static_cast<const IndexHeader *>(base);
+        if (size < sizeof(IndexHeader))
+            return false;
+        if (std::memcmp(header->magic, Magic, sizeof(header->magic)) != 0 || header->version != Version)
+            return false;
+        size_t expected = sizeof(IndexHeader) + header->numWords * sizeof(uint64_t) +
+                          header->numSets * sizeof(SetRecord) +
+                          (header->numNodes + header->numObjs) * sizeof(uint32_t);
+        if (size < expected || size >= expected + sizeof(uint64_t) || header->numSets == 0)
+            return false;
+        words = reinterpret_cast<const uint64_t *>(bytes + sizeof(IndexHeader));
+        sets = reinterpret_cast<const SetRecord *>(words + header->numWords);
+        nodeSets = reinterpret_cast<const uint32_t *>(sets + header->numSets);
+        objs = nodeSets + header->numNodes;
+
+        // Every reference must stay inside its section, so a corrupt file cannot make a query read past the map
+        for (uint32_t i = 0; i < header->numNodes; ++i)
+        {
+            if (nodeSets[i] >= header->numSets)
+                return false;
+        }
+        for (uint32_t i = 0; i < header->numSets; ++i)
+        {
+            const SetRecord &set = sets[i];
+            if ((uint64_t) set.objBegin + set.objCount > header->numObjs ||
+                (uint64_t) set.wordBegin + set.wordCount > header->numWords)
+                return false;
+        }
+        return true;
+    }
+
+    std::vector<uint64_t> image;        ///< the index built by load
+    void *mapped = nullptr;             ///< the index mapped by open
+    size_t mappedSize = 0;
+
+    const IndexHeader *header = nullptr;
+    const uint64_t *words = nullptr;
+    const SetRecord *sets = nullptr;
+    const uint32_t *nodeSets = nullptr;
+    const uint32_t *objs = nullptr;
+
+    mutable std::vector<uint64_t> memoKeys = std::vector<uint64_t>(MemoSize, 0);   ///< 0: empty slot
+};
+
+#endif //ANSWERS_POINTSTOINDEX_H
@@ -0,0 +1,258 @@
+/**
+ * SVFIRSnapshot.h
+ *
+ * A compact binary snapshot of the statements of an SVFIR and of its ICFG edges.
+ * It is written by the 'svfir' tool and read back through a read-only memory mapping, so tools that only
+ * need the graph structure can skip the LLVM parse and SVFIR construction: cflr reads the statements, cfga the
+ * ICFG. collectStmts and collectICFG are the one place that flattens the live graphs into records; tools
+ * building from a live SVFIR use them too, so both paths see the same graphs.
+ *
+ * Layout (all fields are little-endian uint32_t):
+ *   SnapshotHeader | module identifier (padded to 4 bytes) | StmtRecord[] | ICFGEdgeRecord[]
+ */
+
+#ifndef ANSWERS_SVFIRSNAPSHOT_H
+#define ANSWERS_SVFIRSNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SVF-LLVM/SVFIRBuilder.h"
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t moduleIdLen;
+    uint32_t numStmts;
+    uint32_t numICFGEdges;
+    uint32_t mainEntry;     // ICFG node of main's entry, NoNode if the module has no main
+    uint32_t mainExit;      // ICFG node of main's exit, NoNode if the module has no main
+};
+
+/// A PAG statement; Phi/Select statements are stored as one record per operand (operand -> result)
+struct StmtRecord
+{
+    uint32_t kind;  // SVF::SVFStmt::PEDGEK
+    uint32_t src;
+    uint32_t dst;
+};
+
+/// An ICFG edge; a Call or Ret edge names its call node, so that paths can match returns with calls
+struct ICFGEdgeRecord
+{
+    enum Kind : uint32_t
+    {
+        Intra, Call, Ret
+    };
+    uint32_t kind;
+    uint32_t src;
+    uint32_t dst;
+    uint32_t callSite;  // the call node of Call and Ret edges, src for Intra edges
+};
+
+/// The ICFG as records
+struct ICFGRecords
+{
+    static constexpr uint32_t NoNode = UINT32_MAX;
+
+    std::vector<ICFGEdgeRecord> edges;
+    uint32_t mainEntry = NoNode;
+    uint32_t mainExit = NoNode;
+};
+
+
+class SVFIRSnapshot
+{
+public:
+    static constexpr const char *Magic = "SVFIRSN";
+    static constexpr uint32_t Version = 3;
+
+    SVFIRSnapshot() = default;
+    SVFIRSnapshot(const SVFIRSnapshot &) = delete;
+    SVFIRSnapshot &operator=(const SVFIRSnapshot &) = delete;
+
+    ~SVFIRSnapshot()
+    { close(); }
+
+    /// Map a snapshot file; returns false if it is missing or malformed
+    bool open(const std::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(SnapshotHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        size = st.st_size;
+        base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            base = nullptr;
+            return false;
+        }
+
+        header = static_cast<const SnapshotHeader *>(base);
+        if (std::memcmp(header->magic, Magic, sizeof(header->magic)) != 0 || header->version != Version ||
+            size != sizeof(SnapshotHeader) + padded(header->moduleIdLen) + header->numStmts * sizeof(StmtRecord) +
+                    header->numICFGEdges * sizeof(ICFGEdgeRecord))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (base)
+            munmap(base, size);
+        base = nullptr;
+        header = nullptr;
+        size = 0;
+    }
+
+    std::string getModuleIdentifier() const
+    { return std::string(bytes(sizeof(SnapshotHeader)), header->moduleIdLen); }
+
+    //{@ Zero-copy views into the mapping
+    const StmtRecord *stmtBegin() const
+    { return reinterpret_cast<const StmtRecord *>(bytes(stmtOffset())); }
+
+    const StmtRecord *stmtEnd() const
+    { return stmtBegin() + header->numStmts; }
+
+    const ICFGEdgeRecord *icfgEdgeBegin() const
+    { return reinterpret_cast<const ICFGEdgeRecord *>(stmtEnd()); }
+
+    const ICFGEdgeRecord *icfgEdgeEnd() const
+    { return icfgEdgeBegin() + header->numICFGEdges; }
+    //@}
+
+    inline uint32_t getMainEntry() const
+    { return header->mainEntry; }
+
+    inline uint32_t getMainExit() const
+    { return header->mainExit; }
+
+    /// The statements of pag as records
+    static std::vector<StmtRecord> collectStmts(SVF::SVFIR *pag)
+    {
+        std::vector<StmtRecord> stmts;
+        for (auto kind : {SVF::SVFStmt::Addr, SVF::SVFStmt::Copy, SVF::SVFStmt::Store, SVF::SVFStmt::Load,
+                          SVF::SVFStmt::Call, SVF::SVFStmt::Ret, SVF::SVFStmt::Gep,
+                          SVF::SVFStmt::ThreadFork, SVF::SVFStmt::ThreadJoin})
+        {
+            for (auto stmt : pag->getSVFStmtSet(kind))
+                stmts.push_back({(uint32_t) kind, stmt->getSrcID(), stmt->getDstID()});
+        }
+        for (auto stmt : pag->getSVFStmtSet(SVF::SVFStmt::Phi))
+        {
+            auto phi = SVF::SVFUtil::cast<SVF::PhiStmt>(stmt);
+            for (auto opVar : phi->getOpndVars())
+                stmts.push_back({(uint32_t) SVF::SVFStmt::Phi, opVar->getId(), phi->getResID()});
+        }
+        for (auto stmt : pag->getSVFStmtSet(SVF::SVFStmt::Select))
+        {
+            auto sel = SVF::SVFUtil::cast<SVF::SelectStmt>(stmt);
+            for (auto opVar : sel->getOpndVars())
+                stmts.push_back({(uint32_t) SVF::SVFStmt::Select, opVar->getId(), sel->getResID()});
+        }
+        return stmts;
+    }
+
+    /// The edges of icfg as records, and the entry and exit of main
+    static ICFGRecords collectICFG(SVF::ICFG *icfg)
+    {
+        ICFGRecords records;
+        for (auto &it : *icfg)
+        {
+            auto node = it.second;
+            if (auto entry = SVF::SVFUtil::dyn_cast<SVF::FunEntryICFGNode>(node))
+            {
+                if (entry->getFun()->getName() == "main")
+                    records.mainEntry = it.first;
+            }
+            else if (auto exit = SVF::SVFUtil::dyn_cast<SVF::FunExitICFGNode>(node))
+            {
+                if (exit->getFun()->getName() == "main")
+                    records.mainExit = it.first;
+            }
+
+            for (auto edge : node->getOutEdges())
+            {
+                if (SVF::SVFUtil::isa<SVF::IntraCFGEdge>(edge))
+                    records.edges.push_back({ICFGEdgeRecord::Intra, edge->getSrcID(), edge->getDstID(),
+                                             edge->getSrcID()});
+                else if (SVF::SVFUtil::isa<SVF::CallCFGEdge>(edge))
+                    records.edges.push_back({ICFGEdgeRecord::Call, edge->getSrcID(), edge->getDstID(),
+                                             edge->getSrcID()});
+                else if (SVF::SVFUtil::isa<SVF::RetCFGEdge>(edge))
+                {
+                    auto retNode = SVF::SVFUtil::cast<SVF::RetICFGNode>(edge->getDstNode());
+                    records.edges.push_back({ICFGEdgeRecord::Ret, edge->getSrcID(), edge->getDstID(),
+                                             retNode->getCallICFGNode()->getId()});
+                }
+            }
+        }
+        return records;
+    }
+
+    /// Serialize the statements and the ICFG of pag into path
+    static bool write(SVF::SVFIR *pag, const std::string &path)
+    { return write(collectStmts(pag), pag->getModuleIdentifier(), path, collectICFG(pag->getICFG())); }
+
+    /// Serialize stmts and icfg, labelled with moduleId, into path
+    static bool write(const std::vector<StmtRecord> &stmts, const std::string &moduleId, const std::string &path,
+                      const ICFGRecords &icfg = ICFGRecords())
+    {
+        SnapshotHeader header{};
+        std::memcpy(header.magic, Magic, sizeof(header.magic));
+        header.version = Version;
+        header.moduleIdLen = moduleId.size();
+        header.numStmts = stmts.size();
+        header.numICFGEdges = icfg.edges.size();
+        header.mainEntry = icfg.mainEntry;
+        header.mainExit = icfg.mainExit;
+
+        std::ofstream out(path, std::ios::out | std::ios::binary);
+        if (!out)
+            return false;
+        std::string paddedId = moduleId;
+        paddedId.resize(padded(moduleId.size()), '\0');
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(paddedId.data(), paddedId.size());
+        out.write(reinterpret_cast<const char *>(stmts.data()), stmts.size() * sizeof(StmtRecord));
+        out.write(reinterpret_cast<const char *>(icfg.edges.data()), icfg.edges.size() * sizeof(ICFGEdgeRecord));
+        return (bool) out;
+    }
+
+protected:
+    static inline size_t padded(size_t len)
+    { return (len + 3) & ~(size_t) 3; }
+
+    inline size_t stmtOffset() const
+    { return sizeof(SnapshotHeader) + padded(header->moduleIdLen); }
+
+    inline const char *bytes(size_t offset) const
+    { return static_cast<const char *>(base) + offset; }
+
+    void *base = nullptr;
+    size_t size = 0;
+    const SnapshotHeader *header = nullptr;
+};
+
+#endif //ANSWERS_SVFIRSNAPSHOT_H
@@ -0,0 +1,390 @@
+/**
+ * SetKernels.h
+ *
+ * Word-parallel kernels for bit-vector sets, shared by the solvers: union with change detection, intersection,
+ * difference, overlap test and popcount over arrays of 64-bit words. Each kernel has a scalar, an SSE2 and an
+ * AVX2 version; the widest one the CPU supports is picked on first use (setKernels()), so one binary runs
+ * everywhere.
+ *
+ * WordSet is the set type built on them: a bit vector over dense element indices with trailing zero words
+ * trimmed, so equal sets have equal words and can be hashed and compared directly.
+ */
+
+#ifndef ANSWERS_SETKERNELS_H
+#define ANSWERS_SETKERNELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SET_KERNELS_X86 1
+#endif
+
+/// One implementation of every kernel; n counts 64-bit words
+struct SetKernelTable
+{
+    const char *name;
+    /// dst |= src; returns true if dst changed
+    bool (*orInto)(uint64_t *dst, const uint64_t *src, size_t n);
+    /// dst = a & b
+    void (*andWords)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+    /// dst = a & ~b
+    void (*andNotWords)(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n);
+    /// (a & b) != 0
+    bool (*intersects)(const uint64_t *a, const uint64_t *b, size_t n);
+    /// Number of set bits
+    size_t (*popcount)(const uint64_t *a, size_t n);
+};
+
+namespace SetKernelImpl
+{
+
+inline bool orIntoScalar(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    uint64_t changed = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        changed |= src[i] & ~dst[i];
+        dst[i] |= src[i];
+    }
+    return changed != 0;
+}
+
+inline void andScalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = a[i] & b[i];
+}
+
+inline void andNotScalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = a[i] & ~b[i];
+}
+
+inline bool intersectsScalar(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (a[i] & b[i])
+            return true;
+    }
+    return false;
+}
+
+inline size_t popcountScalar(const uint64_t *a, size_t n)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+        count += __builtin_popcountll(a[i]);
+    return count;
+}
+
+#ifdef SET_KERNELS_X86
+
+// SSE2 is part of the x86-64 baseline; the attribute is for 32-bit builds
+
+__attribute__((target("sse2"))) inline bool orIntoSSE2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    __m128i changed = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        changed = _mm_or_si128(changed, _mm_andnot_si128(d, s));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_or_si128(d, s));
+    }
+    bool tail = orIntoScalar(dst + i, src + i, n - i);
+    return tail || _mm_movemask_epi8(_mm_cmpeq_epi8(changed, _mm_setzero_si128())) != 0xFFFF;
+}
+
+__attribute__((target("sse2"))) inline void andSSE2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_and_si128(x, y));
+    }
+    andScalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2"))) inline void andNotSSE2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_andnot_si128(y, x));
+    }
+    andNotScalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2"))) inline bool intersectsSSE2(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+        __m128i both = _mm_and_si128(x, y);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(both, _mm_setzero_si128())) != 0xFFFF)
+            return true;
+    }
+    return intersectsScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline bool orIntoAVX2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    __m256i changed = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i *) (dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *) (src + i));
+        changed = _mm256_or_si256(changed, _mm256_andnot_si256(d, s));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(d, s));
+    }
+    bool tail = orIntoScalar(dst + i, src + i, n - i);
+    return tail || !_mm256_testz_si256(changed, changed);
+}
+
+__attribute__((target("avx2"))) inline void andAVX2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_and_si256(x, y));
+    }
+    andScalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void andNotAVX2(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_andnot_si256(y, x));
+    }
+    andNotScalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline bool intersectsAVX2(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        if (!_mm256_testz_si256(x, y))
+            return true;
+    }
+    return intersectsScalar(a + i, b + i, n - i);
+}
+
+/// CPUs with AVX2 all have POPCNT, which turns the builtin into one instruction per word
+__attribute__((target("avx2,popcnt"))) inline size_t popcountAVX2(const uint64_t *a, size_t n)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+        count += __builtin_popcountll(a[i]);
+    return count;
+}
+
+#endif // SET_KERNELS_X86
+
+inline SetKernelTable selectKernels()
+{
+#ifdef SET_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        return {"avx2", orIntoAVX2, andAVX2, andNotAVX2, intersectsAVX2, popcountAVX2};
+    if (__builtin_cpu_supports("sse2"))
+        return {"sse2", orIntoSSE2, andSSE2, andNotSSE2, intersectsSSE2, popcountScalar};
+#endif
+    return {"scalar", orIntoScalar, andScalar, andNotScalar, intersectsScalar, popcountScalar};
+}
+
+} // namespace SetKernelImpl
+
+/// The kernels for this CPU, selected once
+inline const SetKernelTable &setKernels()
+{
+    static const SetKernelTable table = SetKernelImpl::selectKernels();
+    return table;
+}
+
+
+/**
+ * A set of small unsigned integers as a trimmed bit vector
+ */
+class WordSet
+{
+public:
+    using Word = uint64_t;
+    static constexpr unsigned WordBits = 64;
+    /// Allocator-aware, so containers on an arena (see AnalysisArena.h) also place the words there
+    using allocator_type = std::pmr::polymorphic_allocator<Word>;
+
+    WordSet() = default;
+    WordSet(const WordSet &) = default;
+    WordSet(WordSet &&) = default;
+    WordSet &operator=(const WordSet &) = default;
+    WordSet &operator=(WordSet &&) = default;
+
+    explicit WordSet(const allocator_type &alloc) :
+            words(alloc)
+    {}
+
+    WordSet(const WordSet &other, const allocator_type &alloc) :
+            words(other.words, alloc)
+    {}
+
+    WordSet(WordSet &&other, const allocator_type &alloc) :
+            words(std::move(other.words), alloc)
+    {}
+
+    /// Iterates over the elements in increasing order
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = unsigned;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const unsigned *;
+        using reference = unsigned;
+
+        const_iterator(const Word *words, size_t numWords, size_t index) :
+                words(words), numWords(numWords), index(index), bits(index < numWords ? words[index] : 0)
+        { skip(); }
+
+        inline unsigned operator*() const
+        { return index * WordBits + __builtin_ctzll(bits); }
+
+        inline const_iterator &operator++()
+        {
+            bits &= bits - 1;
+            skip();
+            return *this;
+        }
+
+        inline bool operator==(const const_iterator &rhs) const
+        { return index == rhs.index && bits == rhs.bits; }
+
+        inline bool operator!=(const const_iterator &rhs) const
+        { return index != rhs.index || bits != rhs.bits; }
+
+    private:
+        /// Advance to the next word with a set bit
+        inline void skip()
+        {
+            while (bits == 0 && index < numWords)
+            {
+                if (++index < numWords)
+                    bits = words[index];
+            }
+        }
+
+        const Word *words;
+        size_t numWords;
+        size_t index;
+        Word bits;
+    };
+
+    inline const_iterator begin() const
+    { return const_iterator(words.data(), words.size(), 0); }
+
+    inline const_iterator end() const
+    { return const_iterator(words.data(), words.size(), words.size()); }
+
+    inline bool empty() const
+    { return words.empty(); }
+
+    inline bool test(unsigned elem) const
+    { return elem / WordBits < words.size() && (words[elem / WordBits] >> (elem % WordBits) & 1); }
+
+    /// Add an element; returns true if it was new
+    inline bool set(unsigned elem)
+    {
+        if (elem / WordBits >= words.size())
+            words.resize(elem / WordBits + 1, 0);
+        Word mask = Word(1) << (elem % WordBits);
+        Word &word = words[elem / WordBits];
+        if (word & mask)
+            return false;
+        word |= mask;
+        return true;
+    }
+
+    /// Union rhs into this set; returns true if this set changed
+    inline bool unionWith(const WordSet &rhs)
+    {
+        if (rhs.words.size() > words.size())
+            words.resize(rhs.words.size(), 0);
+        return setKernels().orInto(words.data(), rhs.words.data(), rhs.words.size());
+    }
+
+    inline WordSet intersect(const WordSet &rhs) const
+    {
+        WordSet result;
+        result.words.resize(std::min(words.size(), rhs.words.size()));
+        setKernels().andWords(result.words.data(), words.data(), rhs.words.data(), result.words.size());
+        result.trim();
+        return result;
+    }
+
+    /// Elements of this set that are not in rhs
+    inline WordSet difference(const WordSet &rhs) const
+    {
+        WordSet result;
+        result.words = words;
+        size_t common = std::min(words.size(), rhs.words.size());
+        setKernels().andNotWords(result.words.data(), words.data(), rhs.words.data(), common);
+        result.trim();
+        return result;
+    }
+
+    inline bool intersects(const WordSet &rhs) const
+    { return setKernels().intersects(words.data(), rhs.words.data(), std::min(words.size(), rhs.words.size())); }
+
+    inline size_t count() const
+    { return setKernels().popcount(words.data(), words.size()); }
+
+    inline bool operator==(const WordSet &rhs) const
+    { return words == rhs.words; }
+
+    inline size_t hash() const
+    {
+        size_t h = words.size();
+        for (auto word : words)
+            h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+        return h;
+    }
+
+    inline const std::pmr::vector<Word> &getWords() const
+    { return words; }
+
+private:
+    /// Drop trailing zero words so that equal sets have equal representations
+    inline void trim()
+    {
+        while (!words.empty() && words.back() == 0)
+            words.pop_back();
+    }
+
+    std::pmr::vector<Word> words;
+};
+
+#endif //ANSWERS_SETKERNELS_H